@@ -0,0 +1,320 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+
+Measures the throughput and the per-frame latency of the encoders and decoders
+for various frame sizes and payloads, the decoder against a naive byte at a time
+decoder for various densities of zeros and the scaling of the multi-threaded
+functions with the number of threads. The results are written to stdout as CSV
+(default) or JSON (--json). Every result is checked, so a broken function cannot
+produce a fast benchmark.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../../src/cobs.h"
+#include "../../src/cobs_parallel.h"
+
+// The amount of data processed per measurement. Small frames are repeated
+// until this is reached.
+#define BYTES_PER_MEASUREMENT (32UL * 1024 * 1024)
+#define MIN_ITERATIONS 16
+#define MAX_LATENCY_SAMPLES 100000
+// The size of the payload used for the zero density sweep and the thread scaling
+#define LARGE_SIZE (16UL * 1024 * 1024)
+
+enum Pattern {
+  PATTERN_NONE,  // No zeros, random non-zero bytes
+  PATTERN_RANDOM,  // Uniformly distributed random bytes
+  PATTERN_ZEROS,  // All zeros, one group per byte
+  PATTERN_RUNS,  // All 0xFF, only full groups, which is the worst case overhead
+  PATTERN_COUNT,
+};
+
+static const char* pattern_names[PATTERN_COUNT] = {"none", "random", "zeros", "runs"};
+
+struct Result {
+  const char* function;
+  size_t size;
+  const char* pattern;
+  unsigned int threads;
+  double throughput;  // MB/s of unencoded data
+  double latency[3];  // p50, p99, p99.9 in ns
+};
+
+static Result make_result(const char* function, const size_t size, const char* pattern, const unsigned int threads = 1)
+{
+  Result result = {function, size, pattern, threads, 0.0, {0.0, 0.0, 0.0}};
+  return result;
+}
+
+static bool json_output = false;
+static bool first_result = true;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+static void fill_payload(uint8_t* payload, const size_t size, const Pattern pattern)
+{
+  srand(42);
+  for (size_t i = 0; i < size; i++) {
+    switch (pattern) {
+      case PATTERN_NONE: payload[i] = rand() % 255 + 1; break;
+      case PATTERN_RANDOM: payload[i] = rand() % 256; break;
+      case PATTERN_ZEROS: payload[i] = 0x00; break;
+      default: payload[i] = 0xFF; break;
+    }
+  }
+}
+
+/**
+ * Fill the payload with random non-zero bytes and the given percentage of zeros.
+ */
+static void fill_density(uint8_t* payload, const size_t size, const unsigned int zero_percentage)
+{
+  srand(42);
+  for (size_t i = 0; i < size; i++) {
+    payload[i] = (unsigned int)(rand() % 100) < zero_percentage ? 0x00 : rand() % 255 + 1;
+  }
+}
+
+/**
+ * Abort the benchmark, if a function returned a wrong result.
+ */
+static void check(const bool valid, const char* function)
+{
+  if (not valid) {
+    fprintf(stderr, "%s returned a wrong result\n", function);
+    exit(1);
+  }
+}
+
+/**
+ * A naive decoder, that copies the data one byte at a time. This is the
+ * reference for decode_to().
+ */
+static size_t decode_naive(const uint8_t* source, const size_t size, uint8_t* destination)
+{
+  const uint8_t* endOfSource = source + size;
+  uint8_t* cursor = destination;
+  while (source < endOfSource) {
+    const uint8_t code = *source++;
+    if (code == 0 or code - 1 > endOfSource - source) return 0;
+    for (uint8_t i = 1; i < code; i++) {
+      *cursor++ = *source++;
+    }
+    if (code != 0xFF and source < endOfSource) {
+      *cursor++ = 0x00;
+    }
+  }
+  return cursor - destination;
+}
+
+static void print_result(const Result& result)
+{
+  if (json_output) {
+    printf("%s\n  {\"function\": \"%s\", \"size\": %lu, \"pattern\": \"%s\", \"threads\": %u, \"throughput_mb_s\": %.1f, \"latency_ns\": {\"p50\": %.0f, \"p99\": %.0f, \"p999\": %.0f}}",
+      first_result ? "[" : ",", result.function, (unsigned long)result.size, result.pattern, result.threads, result.throughput,
+      result.latency[0], result.latency[1], result.latency[2]);
+  } else {
+    if (first_result)
+      printf("function,size,pattern,threads,throughput_mb_s,latency_p50_ns,latency_p99_ns,latency_p999_ns\n");
+    printf("%s,%lu,%s,%u,%.1f,%.0f,%.0f,%.0f\n", result.function, (unsigned long)result.size, result.pattern, result.threads,
+      result.throughput, result.latency[0], result.latency[1], result.latency[2]);
+  }
+  first_result = false;
+  fflush(stdout);
+}
+
+/**
+ * Run a function repeatedly. The throughput is measured over all iterations,
+ * the latency percentiles are measured per call.
+ *
+ * @param function Called as function() and must process size bytes of payload
+ */
+template <typename Function>
+static void measure(Result& result, Function function)
+{
+  size_t iterations = BYTES_PER_MEASUREMENT / (result.size == 0 ? 1 : result.size);
+  if (iterations < MIN_ITERATIONS)
+    iterations = MIN_ITERATIONS;
+
+  const double start = now();
+  for (size_t i = 0; i < iterations; i++) {
+    function();
+  }
+  result.throughput = (double)result.size * iterations / (now() - start) / 1e6;
+
+  const size_t sample_count = iterations < MAX_LATENCY_SAMPLES ? iterations : MAX_LATENCY_SAMPLES;
+  double* samples = (double*)malloc(sample_count * sizeof(double));
+  for (size_t i = 0; i < sample_count; i++) {
+    const double begin = now();
+    function();
+    samples[i] = (now() - begin) * 1e9;
+  }
+  qsort(samples, sample_count, sizeof(double), compare_double);
+  result.latency[0] = samples[sample_count * 50 / 100];
+  result.latency[1] = samples[sample_count * 99 / 100];
+  result.latency[2] = samples[sample_count * 999 / 1000];
+  free(samples);
+
+  print_result(result);
+}
+
+/**
+ * Decode a capture in place using decode_frames_parallel(). The capture must be
+ * restored before each run, which is not part of the measurement.
+ */
+static void measure_batch(Result& result, const uint8_t* capture, uint8_t* buffer, const size_t frame_count)
+{
+  double elapsed = 0;
+  std::vector<double> samples;
+  for (unsigned int j = 0; j < MIN_ITERATIONS; j++) {
+    memcpy(buffer, capture, result.size);
+    const double start = now();
+    const size_t decoded_frames = cobs::decode_frames_parallel(buffer, result.size, result.threads).size();
+    samples.push_back((now() - start) * 1e9);
+    elapsed += samples.back();
+    check(decoded_frames == frame_count, result.function);
+  }
+  qsort(samples.data(), samples.size(), sizeof(double), compare_double);
+  result.throughput = (double)result.size * MIN_ITERATIONS / elapsed * 1e3;
+  result.latency[0] = samples[samples.size() * 50 / 100];
+  result.latency[1] = samples[samples.size() * 99 / 100];
+  result.latency[2] = samples[samples.size() * 999 / 1000];
+  print_result(result);
+}
+
+int main(int argc, char*argv[])
+{
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json_output = true;
+    } else if (strcmp(argv[i], "--csv") != 0) {
+      fprintf(stderr, "Usage: %s [--csv|--json]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  const size_t max_size = LARGE_SIZE;
+  uint8_t* payload = (uint8_t*)malloc(max_size);
+  uint8_t* encoded = (uint8_t*)malloc(cobs::max_encoded_size(max_size));
+  uint8_t* decoded = (uint8_t*)malloc(max_size);
+  const size_t block_sizes[] = {1, 16, 64, 254};
+  const size_t frame_sizes[] = {1, 16, 64, 254, 4096, 65536, 1024 * 1024};
+  const unsigned int hardware_threads = std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency();
+
+  for (int pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+    fill_payload(payload, max_size, (Pattern)pattern);
+    const char* pattern_name = pattern_names[pattern];
+
+    // The in place single block functions modify their input, so the input is
+    // restored before every call. This copy is part of the measurement.
+    for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++) {
+      const size_t size = block_sizes[i];
+      uint8_t buffer[255];
+      uint8_t block[255];
+      memcpy(&block[1], payload, size);
+      Result result = make_result("encode", size, pattern_name);
+      measure(result, [&]() {
+        memcpy(buffer, block, size + 1);
+        check(cobs::encode(buffer, size + 1) == size + 1, "encode");
+      });
+
+      cobs::encode(block, size + 1);
+      Result decode_result = make_result("decode", size, pattern_name);
+      measure(decode_result, [&]() {
+        memcpy(buffer, block, size + 1);
+        check(cobs::decode(buffer, size + 1) == size, "decode");
+      });
+    }
+
+    for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+      const size_t size = frame_sizes[i];
+      const size_t capacity = cobs::max_encoded_size(size);
+      const size_t encoded_length = cobs::encode_to(payload, size, encoded, capacity);
+      check(encoded_length > 0, "encode_to");
+      Result result = make_result("encode_to", size, pattern_name);
+      measure(result, [&]() { check(cobs::encode_to(payload, size, encoded, capacity) == encoded_length, "encode_to"); });
+
+      Result decode_result = make_result("decode_to", size, pattern_name);
+      measure(decode_result, [&]() { check(cobs::decode_to(encoded, encoded_length, decoded, size) == size, "decode_to"); });
+      Result naive_result = make_result("decode_naive", size, pattern_name);
+      measure(naive_result, [&]() { check(decode_naive(encoded, encoded_length, decoded) == size, "decode_naive"); });
+    }
+
+    // The multi-threaded encoder using all cores
+    const size_t capacity = cobs::max_encoded_size(max_size);
+    const size_t encoded_length = cobs::encode_to(payload, max_size, encoded, capacity);
+    Result result = make_result("encode_to_parallel", max_size, pattern_name, hardware_threads);
+    measure(result, [&]() {
+      check(cobs::encode_to_parallel(payload, max_size, encoded, capacity, hardware_threads) == encoded_length, "encode_to_parallel");
+    });
+  }
+
+  // The decoder against the naive decoder for increasing densities of zeros
+  const unsigned int zero_percentages[] = {0, 1, 5, 10, 25, 50};
+  const char* density_names[] = {"zeros_0%", "zeros_1%", "zeros_5%", "zeros_10%", "zeros_25%", "zeros_50%"};
+  for (size_t i = 0; i < sizeof(zero_percentages) / sizeof(zero_percentages[0]); i++) {
+    fill_density(payload, max_size, zero_percentages[i]);
+    const size_t encoded_length = cobs::encode_to(payload, max_size, encoded, cobs::max_encoded_size(max_size));
+    Result result = make_result("decode_to", max_size, density_names[i]);
+    measure(result, [&]() { check(cobs::decode_to(encoded, encoded_length, decoded, max_size) == max_size, "decode_to"); });
+    Result naive_result = make_result("decode_naive", max_size, density_names[i]);
+    measure(naive_result, [&]() { check(decode_naive(encoded, encoded_length, decoded) == max_size, "decode_naive"); });
+  }
+
+  // Decode a capture of 254 byte frames in place using an increasing number of threads
+  fill_density(payload, max_size, 10);
+  uint8_t* capture = (uint8_t*)malloc(max_size);
+  size_t capture_length = 0;
+  size_t frame_count = 0;
+  for (size_t offset = 0; capture_length + 256 <= max_size; offset += 254) {
+    capture_length += cobs::encode_to(&payload[offset], 254, &capture[capture_length], max_size - capture_length);
+    capture[capture_length++] = 0x00;
+    frame_count++;
+  }
+  for (unsigned int threads = 1; threads <= hardware_threads; threads *= 2) {
+    Result result = make_result("decode_frames_parallel", capture_length, "zeros_10%", threads);
+    measure_batch(result, capture, decoded, frame_count);
+  }
+  free(capture);
+  if (json_output)
+    printf("\n]\n");
+
+  free(payload);
+  free(encoded);
+  free(decoded);
+  return 0;
+}
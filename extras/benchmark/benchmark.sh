@@ -0,0 +1,4 @@
+#!/bin/bash
+# Pass --json to get JSON instead of CSV
+g++ -O2 -pthread benchmark.cpp -o benchmark
+./benchmark "$@"
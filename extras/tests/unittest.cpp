@@ -25,7 +25,26 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <new>  // std::bad_alloc
 #include "../../src/cobs.h"
+#include "../../src/cobs_stream.h"
+#include "../../src/cobs_batch.h"
+#include "../../src/cobs_parallel.h"
+#include "../../src/cobs_zpe.h"
+#include "../../src/cobs_crc.h"
+#include "../../src/cobs_gather.h"
+#include "../../src/cobs_pipeline.h"
+#include "../../src/cobs_pool.h"
+#include "../../src/cobs_concurrent_pool.h"
+#include "../../src/cobs_transport.h"
+#include "../../src/cobs_coroutine.h"
 
 #define ASSERT_EQUAL_LUINT(value, expected) \
   do {\
@@ -415,6 +434,2205 @@ bool test_decode_invalid(void) {
   return true;
 }
 
+bool test_max_encoded_size(void)
+{
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(0), 1);
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(1), 2);
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(254), 255);
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(255), 257);
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(508), 510);
+  ASSERT_EQUAL_LUINT(cobs::max_encoded_size(4096), 4096 + 17);
+
+  return true;
+}
+
+bool test_encode_to_empty(void)
+{
+  uint8_t output[] = {0xAA, 0xAA};
+  uint8_t expected_output[sizeof(output)] = {0x01, 0xAA};
+
+  size_t encoded_length = cobs::encode_to(NULL, 0, output, sizeof(output));
+
+  ASSERT_EQUAL_LUINT(encoded_length, 1);
+  ASSERT_EQUAL_MEM(output, expected_output, sizeof(output));
+
+  return true;
+}
+
+bool test_encode_to_255_bytes_non_zero(void)
+{
+  uint8_t input[255];
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    input[i] = i % 255 + 1;
+  }
+  // Make the array 1 byte larger to test for bytes written out of bounds
+  uint8_t output[258];
+  output[257] = 0xAA;
+
+  uint8_t expected_output[sizeof(output)];
+  expected_output[0] = 0xFF;
+  memcpy(&expected_output[1], input, 254);
+  expected_output[255] = 0x02;
+  expected_output[256] = input[254];
+  expected_output[257] = 0xAA;
+
+  size_t encoded_length = cobs::encode_to(input, sizeof(input), output, sizeof(output) - 1);
+
+  ASSERT_EQUAL_LUINT(encoded_length, 257);
+  ASSERT_EQUAL_MEM(output, expected_output, sizeof(output));
+
+  return true;
+}
+
+bool test_encode_to_buffer_too_small(void)
+{
+  uint8_t input[] = {0x11, 0x22, 0x00, 0x33};
+  uint8_t output[sizeof(input)];
+
+  size_t encoded_length = cobs::encode_to(input, sizeof(input), output, sizeof(output));
+
+  // We are expecting an error, therefore size 0
+  ASSERT_EQUAL_LUINT(encoded_length, 0);
+
+  return true;
+}
+
+bool test_encode_decode_to_multi_block(void)
+{
+  printf("Encoding and decoding 4096 bytes out of place:\n");
+  // A mixture of long non-zero runs (crossing the 254 byte block boundary)
+  // and short groups
+  uint8_t input[4096];
+  uint32_t lfsr = 0xACE1u;
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    lfsr = lfsr * 1103515245u + 12345u;
+    input[i] = (i < 1024) ? (i % 255 + 1) : (lfsr >> 16) % 8;
+  }
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  uint8_t output[sizeof(input)];
+
+  size_t encoded_length = cobs::encode_to(input, sizeof(input), encoded, sizeof(encoded));
+  printf("\tEncoded %lu byte(s) into %lu byte(s)\n", (unsigned long)sizeof(input), (unsigned long)encoded_length);
+  ASSERT_EQUAL_LUINT(encoded_length != 0, true);
+  ASSERT_EQUAL_LUINT(memchr(encoded, 0x00, encoded_length) == NULL, true);
+
+  size_t decoded_length = cobs::decode_to(encoded, encoded_length, output, sizeof(output));
+  ASSERT_EQUAL_LUINT(decoded_length, sizeof(input));
+  ASSERT_EQUAL_MEM(output, input, sizeof(input));
+
+  return true;
+}
+
+bool test_encode_decode_to_all_sizes(void)
+{
+  // Round trip every frame size around the block boundaries, both with and
+  // without zeros
+  uint8_t input[1024];
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  uint8_t output[sizeof(input)];
+  for (unsigned int pattern = 0; pattern < 2; pattern++) {
+    for (unsigned int i = 0; i < sizeof(input); i++) {
+      input[i] = pattern == 0 ? 0x42 : (i % 7 == 0 ? 0x00 : i);
+    }
+    for (size_t size = 0; size < sizeof(input); size++) {
+      size_t encoded_length = cobs::encode_to(input, size, encoded, sizeof(encoded));
+      ASSERT_EQUAL_LUINT(encoded_length <= cobs::max_encoded_size(size), true);
+      size_t decoded_length = cobs::decode_to(encoded, encoded_length, output, sizeof(output));
+      ASSERT_EQUAL_LUINT(decoded_length, size);
+      ASSERT_EQUAL_MEM(output, input, size);
+    }
+  }
+
+  return true;
+}
+
+bool test_encode_to_matches_encode(void)
+{
+  uint8_t buffer[] = {0x00, 0x11, 0x22, 0x00, 0x33};
+  uint8_t output[cobs::max_encoded_size(sizeof(buffer) - 1)];
+
+  size_t encoded_length = cobs::encode_to(&buffer[1], sizeof(buffer) - 1, output, sizeof(output));
+  cobs::encode(buffer, sizeof(buffer));
+
+  ASSERT_EQUAL_LUINT(encoded_length, sizeof(buffer));
+  ASSERT_EQUAL_MEM(output, buffer, sizeof(buffer));
+
+  return true;
+}
+
+bool test_decode_to_invalid(void)
+{
+  // The first group claims 5 bytes, but there are only 3 bytes left
+  uint8_t input[] = {0x05, 0x11, 0x22, 0x33};
+  uint8_t output[sizeof(input)];
+
+  size_t decoded_length = cobs::decode_to(input, sizeof(input), output, sizeof(output));
+  ASSERT_EQUAL_LUINT(decoded_length, 0);
+
+  // Zero offset
+  input[0] = 0x00;
+  decoded_length = cobs::decode_to(input, sizeof(input), output, sizeof(output));
+  ASSERT_EQUAL_LUINT(decoded_length, 0);
+
+  // The output buffer is too small
+  uint8_t valid_input[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  decoded_length = cobs::decode_to(valid_input, sizeof(valid_input), output, 3);
+  ASSERT_EQUAL_LUINT(decoded_length, 0);
+
+  return true;
+}
+
+bool test_encode_in_place_matches_encode(void)
+{
+  // With a single byte of headroom, the in place encoder must produce the
+  // same result as encode()
+  uint8_t buffer[] = {0xAA, 0x11, 0x22, 0x00, 0x33, 0xAA};
+  uint8_t expected_output[sizeof(buffer)];
+  memcpy(expected_output, buffer, sizeof(buffer));
+  cobs::encode(expected_output, sizeof(buffer) - 1);
+
+  size_t encoded_length = cobs::encode_in_place(buffer, sizeof(buffer) - 2, 1);
+
+  ASSERT_EQUAL_LUINT(encoded_length, sizeof(buffer) - 1);
+  ASSERT_EQUAL_MEM(buffer, expected_output, sizeof(buffer));
+
+  return true;
+}
+
+bool test_encode_in_place_headroom_too_small(void)
+{
+  uint8_t buffer[256 + 1];
+  memset(buffer, 0x42, sizeof(buffer));
+
+  size_t encoded_length = cobs::encode_in_place(buffer, 256, 1);
+
+  // We are expecting an error, therefore size 0
+  ASSERT_EQUAL_LUINT(encoded_length, 0);
+
+  return true;
+}
+
+bool test_encode_in_place_matches_encode_to(void)
+{
+  printf("Encoding up to 1024 bytes in place:\n");
+  // Compare the in place encoder with the out of place encoder for every
+  // frame size around the block boundaries
+  uint8_t input[1024];
+  uint8_t expected_output[cobs::max_encoded_size(sizeof(input))];
+  uint8_t buffer[sizeof(expected_output) + 3];
+  for (unsigned int pattern = 0; pattern < 3; pattern++) {
+    for (unsigned int i = 0; i < sizeof(input); i++) {
+      input[i] = pattern == 0 ? 0x42 : (pattern == 1 ? (i % 300 == 299 ? 0x00 : 0x42) : (i % 5 == 0 ? 0x00 : i));
+    }
+    for (size_t size = 0; size < sizeof(input); size++) {
+      size_t headroom = cobs::headroom(size);
+      size_t expected_length = cobs::encode_to(input, size, expected_output, sizeof(expected_output));
+      // Test both the minimum and a larger headroom
+      for (size_t extra = 0; extra < 3; extra += 2) {
+        memcpy(&buffer[headroom + extra], input, size);
+        buffer[headroom + extra + size] = 0xAA;
+
+        size_t encoded_length = cobs::encode_in_place(buffer, size, headroom + extra);
+        ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+        ASSERT_EQUAL_MEM(buffer, expected_output, encoded_length);
+        // The byte behind the data must not be touched
+        ASSERT_EQUAL_LUINT(buffer[headroom + extra + size], 0xAA);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_encode_kernels_random(void)
+{
+  printf("Comparing the encoder kernels using random data:\n");
+  // Every vectorized kernel must produce the same output as the scalar kernel
+  uint8_t input[255];
+  uint8_t expected_output[sizeof(input)];
+  uint8_t output[sizeof(input) + 1];
+  alignas(8) uint8_t swar_buffer[sizeof(input) + 8];
+  srand(42);
+  for (unsigned int iteration = 0; iteration < 10000; iteration++) {
+    // Vary the zero density from none to all zeros
+    const unsigned int zero_density = iteration % 11;
+    const size_t size = rand() % sizeof(input) + 1;
+    input[0] = 0x00;
+    for (size_t i = 1; i < size; i++) {
+      input[i] = (unsigned int)(rand() % 10) < zero_density ? 0x00 : rand() % 255 + 1;
+    }
+    memcpy(expected_output, input, size);
+    cobs::detail::encode_block_scalar(expected_output, size);
+
+#if defined(__SSE2__) and not defined(COBS_NO_SIMD)
+    memcpy(output, input, size);
+    output[size] = 0xAA;
+    cobs::detail::encode_block_sse2(output, size);
+    ASSERT_EQUAL_MEM(output, expected_output, size);
+    ASSERT_EQUAL_LUINT(output[size], 0xAA);
+#endif
+#if defined(__AVX2__) and not defined(COBS_NO_SIMD)
+    memcpy(output, input, size);
+    output[size] = 0xAA;
+    cobs::detail::encode_block_avx2(output, size);
+    ASSERT_EQUAL_MEM(output, expected_output, size);
+    ASSERT_EQUAL_LUINT(output[size], 0xAA);
+#endif
+
+    // The SWAR kernels with both word sizes and every alignment of the block
+    uint8_t* shifted = &swar_buffer[iteration % 8];
+    memcpy(shifted, input, size);
+    shifted[size] = 0xAA;
+    cobs::detail::encode_block_swar<uint32_t>(shifted, size);
+    ASSERT_EQUAL_MEM(shifted, expected_output, size);
+    ASSERT_EQUAL_LUINT(shifted[size], 0xAA);
+    memcpy(shifted, input, size);
+    cobs::detail::encode_block_swar<uint64_t>(shifted, size);
+    ASSERT_EQUAL_MEM(shifted, expected_output, size);
+    ASSERT_EQUAL_LUINT(shifted[size], 0xAA);
+
+    // The public function must agree as well
+    memcpy(output, input, size);
+    ASSERT_EQUAL_LUINT(cobs::encode(output, size), size);
+    ASSERT_EQUAL_MEM(output, expected_output, size);
+
+    // With a delimiter, the kernels XOR the output within the same pass
+    uint8_t expected_delimited[sizeof(input)];
+    for (size_t i = 0; i < size; i++) {
+      expected_delimited[i] = expected_output[i] ^ 0x7E;
+    }
+    memcpy(output, input, size);
+    cobs::detail::encode_block_scalar<0x7E>(output, size);
+    ASSERT_EQUAL_MEM(output, expected_delimited, size);
+#if defined(__SSE2__) and not defined(COBS_NO_SIMD)
+    memcpy(output, input, size);
+    cobs::detail::encode_block_sse2<0x7E>(output, size);
+    ASSERT_EQUAL_MEM(output, expected_delimited, size);
+#endif
+#if defined(__AVX2__) and not defined(COBS_NO_SIMD)
+    memcpy(output, input, size);
+    cobs::detail::encode_block_avx2<0x7E>(output, size);
+    ASSERT_EQUAL_MEM(output, expected_delimited, size);
+#endif
+    memcpy(shifted, input, size);
+    cobs::detail::encode_block_swar<uint32_t, 0x7E>(shifted, size);
+    ASSERT_EQUAL_MEM(shifted, expected_delimited, size);
+    memcpy(shifted, input, size);
+    cobs::detail::encode_block_swar<uint64_t, 0x7E>(shifted, size);
+    ASSERT_EQUAL_MEM(shifted, expected_delimited, size);
+    memcpy(output, input, size);
+    ASSERT_EQUAL_LUINT(cobs::encode<0x7E>(output, size), size);
+    ASSERT_EQUAL_MEM(output, expected_delimited, size);
+    ASSERT_EQUAL_LUINT(cobs::decode<0x7E>(output, size), size - 1);
+    ASSERT_EQUAL_MEM(&output[1], &input[1], size - 1);
+  }
+
+  return true;
+}
+
+bool test_decode_to_random_corruption(void)
+{
+  // Decoding garbage must never write out of bounds
+  uint8_t input[600];
+  uint8_t output[sizeof(input) + 1];
+  srand(42);
+  for (unsigned int iteration = 0; iteration < 10000; iteration++) {
+    const size_t size = rand() % sizeof(input);
+    const size_t capacity = rand() % sizeof(input);
+    for (size_t i = 0; i < size; i++) {
+      input[i] = rand() % 256;
+    }
+    output[capacity] = 0xAA;
+
+    size_t decoded_length = cobs::decode_to(input, size, output, capacity);
+    ASSERT_EQUAL_LUINT(decoded_length <= capacity, true);
+    ASSERT_EQUAL_LUINT(output[capacity], 0xAA);
+  }
+
+  return true;
+}
+
+struct FrameLog {
+  uint8_t data[8192];
+  size_t lengths[64];
+  size_t size;
+  size_t count;
+};
+
+static void log_frame(FrameLog& log, const uint8_t* frame, size_t length)
+{
+  if (log.count < sizeof(log.lengths) / sizeof(log.lengths[0]) and log.size + length <= sizeof(log.data)) {
+    memcpy(&log.data[log.size], frame, length);
+    log.size += length;
+    log.lengths[log.count] = length;
+  }
+  log.count++;
+}
+
+bool test_stream_decoder_chunks(void)
+{
+  printf("Decoding a stream of frames in chunks of random size:\n");
+  // Encode a number of random frames into a single stream
+  uint8_t payload[4096];
+  size_t frame_sizes[20];
+  uint8_t stream[cobs::max_encoded_size(sizeof(payload)) + 20 * 2];
+  size_t payload_size = 0;
+  size_t stream_size = 0;
+  srand(42);
+  stream[stream_size++] = 0x00;  // A leading delimiter must be ignored
+  for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+    frame_sizes[i] = rand() % 400;
+    for (size_t j = 0; j < frame_sizes[i]; j++) {
+      payload[payload_size + j] = rand() % 3 == 0 ? 0x00 : rand() % 256;
+    }
+    stream_size += cobs::encode_to(&payload[payload_size], frame_sizes[i], &stream[stream_size], sizeof(stream) - stream_size);
+    stream[stream_size++] = 0x00;
+    payload_size += frame_sizes[i];
+  }
+
+  for (size_t max_chunk_size = 1; max_chunk_size < 2048; max_chunk_size *= 3) {
+    cobs::StreamDecoder<400> decoder;
+    FrameLog log = {};
+    for (size_t offset = 0; offset < stream_size; ) {
+      size_t chunk_size = rand() % max_chunk_size + 1;
+      if (chunk_size > stream_size - offset)
+        chunk_size = stream_size - offset;
+      decoder.feed(&stream[offset], chunk_size, [&log](const uint8_t* frame, size_t length) { log_frame(log, frame, length); });
+      offset += chunk_size;
+    }
+
+    ASSERT_EQUAL_LUINT(log.count, sizeof(frame_sizes) / sizeof(frame_sizes[0]));
+    for (size_t i = 0; i < log.count; i++) {
+      ASSERT_EQUAL_LUINT(log.lengths[i], frame_sizes[i]);
+    }
+    ASSERT_EQUAL_LUINT(log.size, payload_size);
+    ASSERT_EQUAL_MEM(log.data, payload, payload_size);
+    ASSERT_EQUAL_LUINT(decoder.discarded(), 0);
+  }
+
+  return true;
+}
+
+bool test_stream_decoder_invalid(void)
+{
+  // A truncated frame, a frame that is too large and a valid frame
+  uint8_t stream[] = {0x05, 0x11, 0x22, 0x00, 0x06, 0x11, 0x22, 0x33, 0x44, 0x55, 0x00, 0x03, 0x11, 0x22, 0x02, 0x33, 0x00};
+  uint8_t expected_output[] = {0x11, 0x22, 0x00, 0x33};
+  cobs::StreamDecoder<4> decoder;
+  FrameLog log = {};
+
+  decoder.feed(stream, sizeof(stream), [&log](const uint8_t* frame, size_t length) { log_frame(log, frame, length); });
+
+  ASSERT_EQUAL_LUINT(log.count, 1);
+  ASSERT_EQUAL_LUINT(log.lengths[0], sizeof(expected_output));
+  ASSERT_EQUAL_MEM(log.data, expected_output, sizeof(expected_output));
+  ASSERT_EQUAL_LUINT(decoder.discarded(), 2);
+
+  return true;
+}
+
+bool test_stream_encoder_chunks(void)
+{
+  printf("Encoding frames in chunks of random size:\n");
+  uint8_t payload[1024];
+  uint8_t expected_output[cobs::max_encoded_size(sizeof(payload)) + 1];
+  uint8_t output[sizeof(expected_output)];
+  cobs::StreamEncoder encoder;
+  srand(42);
+  for (unsigned int iteration = 0; iteration < 1000; iteration++) {
+    const size_t size = rand() % sizeof(payload);
+    const unsigned int pattern = iteration % 3;
+    for (size_t i = 0; i < size; i++) {
+      payload[i] = pattern == 0 ? rand() % 255 + 1 : (pattern == 1 ? rand() % 4 : rand() % 256);
+    }
+    size_t expected_length = cobs::encode_to(payload, size, expected_output, sizeof(expected_output));
+    expected_output[expected_length++] = 0x00;
+
+    size_t output_length = 0;
+    bool overflow = false;
+    auto sink = [&](const uint8_t* data, size_t length) {
+      if (length > sizeof(output) - output_length) {
+        overflow = true;
+        return;
+      }
+      memcpy(&output[output_length], data, length);
+      output_length += length;
+    };
+    for (size_t offset = 0; offset < size; ) {
+      size_t chunk_size = rand() % 300 + 1;
+      if (chunk_size > size - offset)
+        chunk_size = size - offset;
+      encoder.write(&payload[offset], chunk_size, sink);
+      offset += chunk_size;
+    }
+    encoder.finish(sink);
+
+    ASSERT_EQUAL_LUINT(overflow, false);
+    ASSERT_EQUAL_LUINT(output_length, expected_length);
+    ASSERT_EQUAL_MEM(output, expected_output, expected_length);
+  }
+
+  return true;
+}
+
+bool test_encode_decode_in_place_all_sizes(void)
+{
+  uint8_t input[1024];
+  uint8_t buffer[cobs::max_encoded_size(sizeof(input))];
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    input[i] = i % 300 == 299 ? 0x00 : i % 255 + 1;
+  }
+  for (size_t size = 0; size < sizeof(input); size++) {
+    size_t encoded_length = cobs::encode_to(input, size, buffer, sizeof(buffer));
+    size_t decoded_length = cobs::decode_in_place(buffer, encoded_length);
+    ASSERT_EQUAL_LUINT(decoded_length, size);
+    ASSERT_EQUAL_MEM(buffer, input, size);
+  }
+
+  return true;
+}
+
+bool test_decode_frames(void)
+{
+  printf("Decoding a batch of frames:\n");
+  uint8_t payload[300];
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = i % 7 == 0 ? 0x00 : i;
+  }
+  // Valid frames of various sizes, an empty frame, an invalid frame and a
+  // trailing incomplete frame
+  const size_t frame_sizes[] = {0, 1, 5, 254, 255, 300};
+  uint8_t buffer[2048];
+  size_t size = 0;
+  for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+    size += cobs::encode_to(payload, frame_sizes[i], &buffer[size], sizeof(buffer) - size);
+    buffer[size++] = 0x00;
+  }
+  buffer[size++] = 0x00;  // An empty frame
+  const uint8_t invalid_frame[] = {0x05, 0x11, 0x22, 0x00};
+  memcpy(&buffer[size], invalid_frame, sizeof(invalid_frame));
+  size += sizeof(invalid_frame);
+  size += cobs::encode_to(payload, 10, &buffer[size], sizeof(buffer) - size);
+  buffer[size++] = 0x00;
+  const size_t complete_size = size;
+  buffer[size++] = 0x03;  // Incomplete
+  buffer[size++] = 0x11;
+
+  cobs::FrameInfo frames[16];
+  size_t consumed;
+  size_t frame_count = cobs::decode_frames(buffer, size, frames, 16, &consumed);
+
+  ASSERT_EQUAL_LUINT(frame_count, 8);
+  ASSERT_EQUAL_LUINT(consumed, complete_size);
+  for (size_t i = 0; i < sizeof(frame_sizes) / sizeof(frame_sizes[0]); i++) {
+    ASSERT_EQUAL_LUINT(frames[i].status == cobs::Status::OK, true);
+    ASSERT_EQUAL_LUINT(frames[i].length, frame_sizes[i]);
+    ASSERT_EQUAL_MEM(&buffer[frames[i].offset], payload, frame_sizes[i]);
+  }
+  ASSERT_EQUAL_LUINT(frames[6].status == cobs::Status::OUT_OF_RANGE, true);
+  ASSERT_EQUAL_LUINT(frames[7].status == cobs::Status::OK, true);
+  ASSERT_EQUAL_LUINT(frames[7].length, 10);
+  ASSERT_EQUAL_MEM(&buffer[frames[7].offset], payload, 10);
+
+  // An empty buffer
+  frame_count = cobs::decode_frames(buffer, 0, frames, 16, &consumed);
+  ASSERT_EQUAL_LUINT(frame_count, 0);
+  ASSERT_EQUAL_LUINT(consumed, 0);
+
+  return true;
+}
+
+bool test_decode_frames_table_full(void)
+{
+  uint8_t buffer[] = {0x02, 0x11, 0x00, 0x02, 0x22, 0x00, 0x02, 0x33, 0x00};
+  cobs::FrameInfo frames[2];
+  size_t consumed;
+
+  size_t frame_count = cobs::decode_frames(buffer, sizeof(buffer), frames, 2, &consumed);
+
+  ASSERT_EQUAL_LUINT(frame_count, 2);
+  ASSERT_EQUAL_LUINT(consumed, 6);
+  ASSERT_EQUAL_LUINT(buffer[frames[1].offset], 0x22);
+  // The remaining frame is untouched
+  ASSERT_EQUAL_LUINT(buffer[6], 0x02);
+
+  return true;
+}
+
+static size_t build_capture(uint8_t* buffer, const size_t size)
+{
+  // Fill the buffer with random frames, some of them invalid, and leave an
+  // incomplete frame at the end
+  uint8_t payload[600];
+  size_t length = 0;
+  srand(42);
+  while (length + cobs::max_encoded_size(sizeof(payload)) + 1 < size) {
+    const size_t payload_size = rand() % sizeof(payload);
+    for (size_t i = 0; i < payload_size; i++) {
+      payload[i] = rand() % 4 == 0 ? 0x00 : rand() % 256;
+    }
+    length += cobs::encode_to(payload, payload_size, &buffer[length], size - length);
+    if (rand() % 50 == 0)
+      buffer[length - 1] = 0xFF;  // Corrupt the frame
+    buffer[length++] = 0x00;
+  }
+  while (length < size) {
+    buffer[length++] = 0x42;
+  }
+  return length;
+}
+
+bool test_decode_frames_parallel(void)
+{
+  printf("Decoding a capture using multiple threads:\n");
+  const size_t size = 4 * 1024 * 1024;
+  uint8_t* buffer = (uint8_t*)malloc(size);
+  uint8_t* expected_buffer = (uint8_t*)malloc(size);
+  build_capture(buffer, size);
+  memcpy(expected_buffer, buffer, size);
+
+  size_t expected_consumed;
+  std::vector<cobs::FrameInfo> expected_frames(size / 2);
+  expected_frames.resize(cobs::decode_frames(expected_buffer, size, expected_frames.data(), expected_frames.size(), &expected_consumed));
+
+  size_t consumed;
+  std::vector<cobs::FrameInfo> frames = cobs::decode_frames_parallel(buffer, size, 4, &consumed);
+
+  bool result = true;
+  if (consumed != expected_consumed or frames.size() != expected_frames.size() or memcmp(buffer, expected_buffer, size) != 0) {
+    printf("%30s: Failed, the parallel decoder does not match the serial decoder\n", __func__);
+    result = false;
+  }
+  for (size_t i = 0; result and i < frames.size(); i++) {
+    if (frames[i].offset != expected_frames[i].offset or frames[i].length != expected_frames[i].length or frames[i].status != expected_frames[i].status) {
+      printf("%30s: Failed, frame %lu does not match the serial decoder\n", __func__, (unsigned long)i);
+      result = false;
+    }
+  }
+  printf("\tDecoded %lu frame(s)\n", (unsigned long)frames.size());
+
+  free(buffer);
+  free(expected_buffer);
+  return result;
+}
+
+bool test_decode_frames_parallel_long_tail(void)
+{
+  // The incomplete frame at the end spans several chunks
+  const size_t size = 1024 * 1024;
+  uint8_t* buffer = (uint8_t*)malloc(size);
+  uint8_t* expected_buffer = (uint8_t*)malloc(size);
+  build_capture(buffer, 30000);
+  memset(&buffer[30000], 0x42, size - 30000);
+  memcpy(expected_buffer, buffer, size);
+
+  size_t expected_consumed;
+  std::vector<cobs::FrameInfo> expected_frames(30000);
+  expected_frames.resize(cobs::decode_frames(expected_buffer, size, expected_frames.data(), expected_frames.size(), &expected_consumed));
+
+  size_t consumed;
+  std::vector<cobs::FrameInfo> frames = cobs::decode_frames_parallel(buffer, size, 4, &consumed);
+  const bool matches = memcmp(buffer, expected_buffer, size) == 0;
+  free(buffer);
+  free(expected_buffer);
+
+  ASSERT_EQUAL_LUINT(expected_consumed < 30000, true);
+  ASSERT_EQUAL_LUINT(consumed, expected_consumed);
+  ASSERT_EQUAL_LUINT(frames.size(), expected_frames.size());
+  ASSERT_EQUAL_LUINT(matches, true);
+
+  return true;
+}
+
+bool test_mapped_file(void)
+{
+  char path[] = "/tmp/cobs_unittest_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_EQUAL_LUINT(fd >= 0, true);
+  const uint8_t capture[] = {0x02, 0x11, 0x00, 0x03, 0x22, 0x33, 0x00};
+  ASSERT_EQUAL_LUINT(write(fd, capture, sizeof(capture)), sizeof(capture));
+  close(fd);
+
+  cobs::MappedFile file;
+  bool opened = file.open(path);
+  unlink(path);
+  ASSERT_EQUAL_LUINT(opened, true);
+  ASSERT_EQUAL_LUINT(file.size(), sizeof(capture));
+
+  std::vector<cobs::FrameInfo> frames = cobs::decode_frames_parallel(file.data(), file.size());
+  ASSERT_EQUAL_LUINT(frames.size(), 2);
+  ASSERT_EQUAL_LUINT(frames[1].length, 2);
+  ASSERT_EQUAL_LUINT(file.data()[frames[1].offset + 1], 0x33);
+
+  ASSERT_EQUAL_LUINT(file.open("/nonexistent/cobs_unittest"), false);
+
+  return true;
+}
+
+bool test_encode_to_parallel(void)
+{
+  printf("Encoding large frames using multiple threads:\n");
+  const size_t max_size = 2 * 1024 * 1024;
+  uint8_t* input = (uint8_t*)malloc(max_size);
+  uint8_t* expected_output = (uint8_t*)malloc(cobs::max_encoded_size(max_size));
+  uint8_t* output = (uint8_t*)malloc(cobs::max_encoded_size(max_size) + 1);
+  const size_t sizes[] = {0, 1, 254, 255, 64 * 1024, 254 * 1024, 254 * 1024 + 1, max_size - 1, max_size};
+  bool result = true;
+
+  srand(42);
+  // No zeros, rare zeros, zeros at every 255th byte (full groups followed by
+  // a 0x00) and random data
+  for (unsigned int pattern = 0; result and pattern < 4; pattern++) {
+    for (size_t i = 0; i < max_size; i++) {
+      switch (pattern) {
+        case 0: input[i] = 0x42; break;
+        case 1: input[i] = rand() % 100000 == 0 ? 0x00 : 0x42; break;
+        case 2: input[i] = i % 255 == 254 ? 0x00 : 0x42; break;
+        default: input[i] = rand() % 256; break;
+      }
+    }
+    for (size_t j = 0; result and j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+      const size_t size = sizes[j];
+      const size_t expected_length = cobs::encode_to(input, size, expected_output, cobs::max_encoded_size(size));
+      output[expected_length] = 0xAA;
+      const size_t encoded_length = cobs::encode_to_parallel(input, size, output, cobs::max_encoded_size(size), 4);
+      if (encoded_length != expected_length or memcmp(output, expected_output, expected_length) != 0 or output[expected_length] != 0xAA) {
+        printf("%30s: Failed, the parallel encoder does not match encode_to() for pattern %u and size %lu\n", __func__, pattern, (unsigned long)size);
+        result = false;
+      }
+    }
+  }
+
+  free(input);
+  free(expected_output);
+  free(output);
+  return result;
+}
+
+bool test_encode_decode_fixed_size(void)
+{
+  uint8_t buffer[] = {0xAA, 0x11, 0x22, 0x00, 0x33};
+  uint8_t expected_output[sizeof(buffer)] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  uint8_t expected_decoded[sizeof(buffer)] = {0x00, 0x11, 0x22, 0x00, 0x33};
+
+  size_t encoded_length = cobs::encode_fixed<sizeof(buffer)>(buffer);
+  ASSERT_EQUAL_LUINT(encoded_length, sizeof(buffer));
+  ASSERT_EQUAL_MEM(buffer, expected_output, sizeof(buffer));
+
+  size_t decoded_length = cobs::decode_fixed<sizeof(buffer)>(buffer);
+  ASSERT_EQUAL_LUINT(decoded_length, sizeof(buffer) - 1);
+  ASSERT_EQUAL_MEM(buffer, expected_decoded, sizeof(buffer));
+
+  // With a delimiter
+  uint8_t expected_delimited[sizeof(buffer)] = {0x03 ^ 0x7E, 0x11 ^ 0x7E, 0x22 ^ 0x7E, 0x02 ^ 0x7E, 0x33 ^ 0x7E};
+  encoded_length = cobs::encode_fixed<sizeof(buffer), 0x7E>(buffer);
+  ASSERT_EQUAL_LUINT(encoded_length, sizeof(buffer));
+  ASSERT_EQUAL_MEM(buffer, expected_delimited, sizeof(buffer));
+  decoded_length = cobs::decode_fixed<sizeof(buffer), 0x7E>(buffer);
+  ASSERT_EQUAL_LUINT(decoded_length, sizeof(buffer) - 1);
+  ASSERT_EQUAL_MEM(buffer, expected_decoded, sizeof(buffer));
+
+  return true;
+}
+
+#if __cplusplus >= 201402L
+static constexpr uint8_t constant_frame[] = {0x11, 0x22, 0x00, 0x33};
+static constexpr auto encoded_constant_frame = cobs::encode_frame(constant_frame);
+// The frame is encoded at compile time
+static_assert(encoded_constant_frame.size == 5, "Invalid encoded size");
+static_assert(encoded_constant_frame.data[0] == 0x03 and encoded_constant_frame.data[3] == 0x02, "Invalid code bytes");
+static_assert(cobs::max_encoded_size<300>() == 302, "Invalid maximum encoded size");
+
+static constexpr struct LargeFrame {
+  uint8_t data[600];
+  constexpr LargeFrame() : data() {
+    for (size_t i = 0; i < sizeof(data); i++) {
+      data[i] = i % 300 == 299 ? 0x00 : i % 255 + 1;
+    }
+  }
+} large_frame;
+
+bool test_encode_frame(void)
+{
+  static constexpr auto encoded = cobs::encode_frame(large_frame.data);
+  uint8_t expected_output[cobs::max_encoded_size(sizeof(large_frame.data))];
+  size_t expected_length = cobs::encode_to(large_frame.data, sizeof(large_frame.data), expected_output, sizeof(expected_output));
+
+  ASSERT_EQUAL_LUINT(encoded.size, expected_length);
+  ASSERT_EQUAL_MEM(encoded.data, expected_output, expected_length);
+
+  static constexpr auto delimited = cobs::encode_frame<0x7E>(large_frame.data);
+  expected_length = cobs::encode_to<0x7E>(large_frame.data, sizeof(large_frame.data), expected_output, sizeof(expected_output));
+  ASSERT_EQUAL_LUINT(delimited.size, expected_length);
+  ASSERT_EQUAL_MEM(delimited.data, expected_output, expected_length);
+
+  return true;
+}
+#endif
+
+bool test_encode_decode_delimiter(void)
+{
+  printf("Encoding and decoding using 0x7E as delimiter:\n");
+  uint8_t input[600];
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    input[i] = i % 300 == 299 ? 0x00 : i % 256;
+  }
+  uint8_t expected_output[cobs::max_encoded_size(sizeof(input))];
+  uint8_t encoded[sizeof(expected_output)];
+  uint8_t output[sizeof(input)];
+
+  // The output is the same as for 0x00 with every byte XORed with the delimiter
+  size_t expected_length = cobs::encode_to(input, sizeof(input), expected_output, sizeof(expected_output));
+  for (size_t i = 0; i < expected_length; i++) {
+    expected_output[i] ^= 0x7E;
+  }
+  size_t encoded_length = cobs::encode_to<0x7E>(input, sizeof(input), encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+  ASSERT_EQUAL_MEM(encoded, expected_output, encoded_length);
+  ASSERT_EQUAL_LUINT(memchr(encoded, 0x7E, encoded_length) == NULL, true);
+
+  size_t decoded_length = cobs::decode_to<0x7E>(encoded, encoded_length, output, sizeof(output));
+  ASSERT_EQUAL_LUINT(decoded_length, sizeof(input));
+  ASSERT_EQUAL_MEM(output, input, sizeof(input));
+
+  // In place
+  uint8_t in_place[sizeof(expected_output)];
+  const size_t headroom = cobs::headroom(sizeof(input));
+  memcpy(&in_place[headroom], input, sizeof(input));
+  ASSERT_EQUAL_LUINT(cobs::encode_in_place<0x7E>(in_place, sizeof(input), headroom), expected_length);
+  ASSERT_EQUAL_MEM(in_place, expected_output, expected_length);
+  ASSERT_EQUAL_LUINT(cobs::decode_in_place<0x7E>(in_place, expected_length), sizeof(input));
+  ASSERT_EQUAL_MEM(in_place, input, sizeof(input));
+
+  // Many frames in a buffer, with a single and with multiple threads
+  static uint8_t large_input[512 * 1024];
+  static uint8_t large_expected[cobs::max_encoded_size(sizeof(large_input))];
+  static uint8_t large_encoded[sizeof(large_expected)];
+  for (size_t i = 0; i < sizeof(large_input); i++) {
+    large_input[i] = i % 1000 < 10 ? 0x00 : i % 7 == 0 ? 0x7E : i % 256;
+  }
+  size_t large_length = cobs::encode_to(large_input, sizeof(large_input), large_expected, sizeof(large_expected));
+  for (size_t i = 0; i < large_length; i++) {
+    large_expected[i] ^= 0x7E;
+  }
+  ASSERT_EQUAL_LUINT(cobs::encode_to_parallel<0x7E>(large_input, sizeof(large_input), large_encoded, sizeof(large_encoded), 4), large_length);
+  ASSERT_EQUAL_MEM(large_encoded, large_expected, large_length);
+
+  // Each run of 0x00 in the input becomes a delimiter, so the input consists of
+  // frames, which decode_frames() must find
+  const size_t stream_length = sizeof(large_input);
+  for (size_t i = 0; i < stream_length; i++) {
+    large_encoded[i] = large_input[i] ^ 0x7E;
+  }
+  static uint8_t frames_buffer[sizeof(large_expected)];
+  memcpy(frames_buffer, large_encoded, stream_length);
+  std::vector<cobs::FrameInfo> parallel_frames = cobs::decode_frames_parallel<0x7E>(frames_buffer, stream_length, 4);
+  static cobs::FrameInfo frames[4096];
+  memcpy(frames_buffer, large_encoded, stream_length);
+  size_t frame_count = cobs::decode_frames<0x7E>(frames_buffer, stream_length, frames, 4096);
+  ASSERT_EQUAL_LUINT(frame_count, parallel_frames.size());
+  ASSERT_EQUAL_LUINT(frame_count > 500, true);
+  for (size_t i = 0; i < frame_count; i++) {
+    ASSERT_EQUAL_LUINT(frames[i].offset, parallel_frames[i].offset);
+    ASSERT_EQUAL_LUINT(frames[i].length, parallel_frames[i].length);
+    ASSERT_EQUAL_LUINT(frames[i].status == parallel_frames[i].status, true);
+  }
+  // The frames match decode_to() of the same data
+  for (size_t i = 0; i < frame_count; i++) {
+    const uint8_t* frame = &large_encoded[frames[i].offset];
+    const size_t frame_size = static_cast<const uint8_t*>(memchr(frame, 0x7E, stream_length - frames[i].offset)) - frame;
+    uint8_t decoded[1024];
+    ASSERT_EQUAL_LUINT(cobs::decode_to<0x7E>(frame, frame_size, decoded, sizeof(decoded)), frames[i].status == cobs::Status::OK ? frames[i].length : 0);
+    if (frames[i].status == cobs::Status::OK)
+      ASSERT_EQUAL_MEM(&frames_buffer[frames[i].offset], decoded, frames[i].length);
+  }
+
+  // The in place single block functions
+  uint8_t buffer[] = {0xAA, 0x11, 0x7E, 0x00, 0x33};
+  uint8_t expected_block[sizeof(buffer)] = {0x03 ^ 0x7E, 0x11 ^ 0x7E, 0x7E ^ 0x7E, 0x02 ^ 0x7E, 0x33 ^ 0x7E};
+  uint8_t expected_decoded[sizeof(buffer)] = {0x00, 0x11, 0x7E, 0x00, 0x33};
+  ASSERT_EQUAL_LUINT(cobs::encode<0x7E>(buffer, sizeof(buffer)), sizeof(buffer));
+  ASSERT_EQUAL_MEM(buffer, expected_block, sizeof(buffer));
+  ASSERT_EQUAL_LUINT(cobs::decode<0x7E>(buffer, sizeof(buffer)), sizeof(buffer) - 1);
+  ASSERT_EQUAL_MEM(buffer, expected_decoded, sizeof(buffer));
+
+  return true;
+}
+
+bool test_stream_delimiter(void)
+{
+  uint8_t payload[] = {0x11, 0x7E, 0x00, 0x33};
+  uint8_t stream[16];
+  size_t stream_size = 0;
+  cobs::BasicStreamEncoder<0x7E> encoder;
+  auto sink = [&](const uint8_t* data, size_t length) {
+    // Too much output is caught by the size check below
+    const size_t copied = length < sizeof(stream) - stream_size ? length : sizeof(stream) - stream_size;
+    memcpy(&stream[stream_size], data, copied);
+    stream_size += copied;
+  };
+  encoder.write(payload, sizeof(payload), sink);
+  encoder.finish(sink);
+  encoder.write(payload, sizeof(payload), sink);
+  encoder.finish(sink);
+
+  ASSERT_EQUAL_LUINT(stream_size, 2 * (sizeof(payload) + 2));
+  ASSERT_EQUAL_LUINT(stream[sizeof(payload) + 1], 0x7E);
+  ASSERT_EQUAL_LUINT(memchr(stream, 0x7E, sizeof(payload) + 1) == NULL, true);
+
+  cobs::StreamDecoder<16, 0x7E> decoder;
+  FrameLog log = {};
+  decoder.feed(stream, stream_size, [&log](const uint8_t* frame, size_t length) { log_frame(log, frame, length); });
+
+  ASSERT_EQUAL_LUINT(log.count, 2);
+  ASSERT_EQUAL_LUINT(log.lengths[0], sizeof(payload));
+  ASSERT_EQUAL_MEM(log.data, payload, sizeof(payload));
+  ASSERT_EQUAL_MEM(&log.data[sizeof(payload)], payload, sizeof(payload));
+
+  return true;
+}
+
+bool test_encode_reduced(void)
+{
+  // The last byte 0x35 is larger than the code 0x06 and replaces it
+  uint8_t buffer[] = {0xAA, 0x31, 0x32, 0x33, 0x34, 0x35, 0xAA};
+  uint8_t expected_output[] = {0x35, 0x31, 0x32, 0x33, 0x34};
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(buffer, 6), 5);
+  ASSERT_EQUAL_MEM(buffer, expected_output, sizeof(expected_output));
+
+  // The last byte 0x02 is not larger than the code 0x03
+  uint8_t small[] = {0xAA, 0x00, 0x11, 0x02};
+  uint8_t expected_small[] = {0x01, 0x03, 0x11, 0x02};
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(small, sizeof(small)), sizeof(small));
+  ASSERT_EQUAL_MEM(small, expected_small, sizeof(small));
+
+  // Only the last group is reduced
+  uint8_t groups[] = {0xAA, 0x31, 0x00, 0x04};
+  uint8_t expected_groups[] = {0x02, 0x31, 0x04};
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(groups, sizeof(groups)), 3);
+  ASSERT_EQUAL_MEM(groups, expected_groups, sizeof(expected_groups));
+
+  uint8_t empty[] = {0xAA};
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(empty, 1), 1);
+  ASSERT_EQUAL_LUINT(empty[0], 0x01);
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(buffer, 256), 0);
+  ASSERT_EQUAL_LUINT(cobs::encode_reduced(buffer, 0), 0);
+
+  return true;
+}
+
+bool test_encode_decode_reduced_all_sizes(void)
+{
+  printf("Encoding and decoding COBS/R blocks of all sizes:\n");
+  srand(42);
+  for (size_t size = 0; size <= 254; size++) {
+    for (int round = 0; round < 16; round++) {
+      uint8_t input[254];
+      // Make zeros and small final bytes likely to hit both cases
+      for (size_t i = 0; i < size; i++) {
+        input[i] = rand() % 4 == 0 ? 0x00 : rand() % 256;
+      }
+      if (size > 0 and round % 2)
+        input[size - 1] = rand() % 4;
+      uint8_t buffer[256];
+      memcpy(&buffer[1], input, size);
+      size_t encoded_length = cobs::encode_reduced(buffer, size + 1);
+      ASSERT_EQUAL_LUINT(encoded_length >= size and encoded_length <= size + 1, true);
+      ASSERT_EQUAL_LUINT(memchr(buffer, 0x00, encoded_length) == NULL, true);
+
+      size_t decoded_length = cobs::decode_reduced(buffer, encoded_length);
+      ASSERT_EQUAL_LUINT(decoded_length, size);
+      ASSERT_EQUAL_MEM(&buffer[1], input, size);
+
+      // With a delimiter
+      memcpy(&buffer[1], input, size);
+      encoded_length = cobs::encode_reduced<0x7E>(buffer, size + 1);
+      ASSERT_EQUAL_LUINT(memchr(buffer, 0x7E, encoded_length) == NULL, true);
+      decoded_length = cobs::decode_reduced<0x7E>(buffer, encoded_length);
+      ASSERT_EQUAL_LUINT(decoded_length, size);
+      ASSERT_EQUAL_MEM(&buffer[1], input, size);
+    }
+  }
+
+  return true;
+}
+
+bool test_decode_reduced_invalid(void)
+{
+  uint8_t zero_code[] = {0x02, 0x11, 0x00, 0x22, 0xAA};
+  ASSERT_EQUAL_LUINT(cobs::decode_reduced(zero_code, 4), 0);
+
+  // A reduced block of 255 bytes would decode to 255 data bytes
+  uint8_t large[256];
+  memset(large, 0xFF, sizeof(large));
+  large[0] = 0xFF;
+  large[254] = 0x02;
+  ASSERT_EQUAL_LUINT(cobs::decode_reduced(large, 255), 254);
+  large[0] = 0xFE;
+  large[254] = 0x03;
+  ASSERT_EQUAL_LUINT(cobs::decode_reduced(large, 255), 0);
+
+  // Plain COBS blocks are valid COBS/R blocks
+  uint8_t plain[] = {0x03, 0x11, 0x22, 0x02, 0x33, 0xAA};
+  uint8_t expected[] = {0x00, 0x11, 0x22, 0x00, 0x33};
+  ASSERT_EQUAL_LUINT(cobs::decode_reduced(plain, 5), 4);
+  ASSERT_EQUAL_MEM(plain, expected, sizeof(expected));
+
+  return true;
+}
+
+bool test_encode_zpe_to(void)
+{
+  uint8_t input[] = {0x11, 0x00, 0x00, 0x22, 0x00, 0x33, 0x00, 0x00, 0x00};
+  uint8_t expected_output[] = {0xE2, 0x11, 0x02, 0x22, 0xE2, 0x33, 0xE1};
+  uint8_t output[cobs::max_zpe_encoded_size(sizeof(input))];
+
+  size_t encoded_length = cobs::encode_zpe_to(input, sizeof(input), output, sizeof(output));
+  ASSERT_EQUAL_LUINT(encoded_length, sizeof(expected_output));
+  ASSERT_EQUAL_MEM(output, expected_output, sizeof(expected_output));
+
+  // A single 0x00 is paired with the implicit 0x00 at the end of the frame
+  uint8_t zero[] = {0x00};
+  ASSERT_EQUAL_LUINT(cobs::encode_zpe_to(zero, 1, output, sizeof(output)), 1);
+  ASSERT_EQUAL_LUINT(output[0], 0xE1);
+  ASSERT_EQUAL_LUINT(cobs::encode_zpe_to(zero, 0, output, sizeof(output)), 1);
+  ASSERT_EQUAL_LUINT(output[0], 0x01);
+  // An empty frame may be passed as NULL
+  output[0] = 0xAA;
+  ASSERT_EQUAL_LUINT(cobs::encode_zpe_to(static_cast<const uint8_t*>(NULL), 0, output, sizeof(output)), 1);
+  ASSERT_EQUAL_LUINT(output[0], 0x01);
+  ASSERT_EQUAL_LUINT(cobs::encode_zpe_to(input, sizeof(input), output, cobs::max_zpe_encoded_size(sizeof(input)) - 1), 0);
+
+  return true;
+}
+
+bool test_encode_decode_zpe_to_all_sizes(void)
+{
+  printf("Encoding and decoding COBS/ZPE frames of all sizes:\n");
+  static uint8_t input[700];
+  static uint8_t encoded[cobs::max_zpe_encoded_size(sizeof(input))];
+  static uint8_t output[sizeof(input)];
+  srand(42);
+  for (size_t size = 0; size <= sizeof(input); size++) {
+    // Alternate between runs of zeros and runs of data of random length to
+    // hit all group types
+    for (size_t i = 0; i < size;) {
+      size_t run = rand() % (rand() % 2 ? 4 : 300);
+      for (; run > 0 and i < size; run--) {
+        input[i++] = (rand() % 2) ? 0x00 : rand() % 255 + 1;
+      }
+      for (run = rand() % 8; run > 0 and i < size; run--) {
+        input[i++] = 0x00;
+      }
+    }
+    if (size % 3 == 0)
+      memset(input, 0xFF, size);  // Only full groups
+
+    size_t encoded_length = cobs::encode_zpe_to(input, size, encoded, cobs::max_zpe_encoded_size(size));
+    ASSERT_EQUAL_LUINT(encoded_length > 0, true);
+    ASSERT_EQUAL_LUINT(memchr(encoded, 0x00, encoded_length) == NULL, true);
+    size_t decoded_length = cobs::decode_zpe_to(encoded, encoded_length, output, size);
+    ASSERT_EQUAL_LUINT(decoded_length, size);
+    ASSERT_EQUAL_MEM(output, input, size);
+
+    encoded_length = cobs::encode_zpe_to<0x7E>(input, size, encoded, sizeof(encoded));
+    ASSERT_EQUAL_LUINT(memchr(encoded, 0x7E, encoded_length) == NULL, true);
+    decoded_length = cobs::decode_zpe_to<0x7E>(encoded, encoded_length, output, size);
+    ASSERT_EQUAL_LUINT(decoded_length, size);
+    ASSERT_EQUAL_MEM(output, input, size);
+  }
+
+  return true;
+}
+
+bool test_zpe_size(void)
+{
+  // A sensor record with padding and fields, that are mostly zero
+  struct Record {
+    uint8_t id;
+    uint32_t timestamp;
+    int16_t values[8];
+    uint8_t flags;
+    uint64_t reserved;
+  } record;
+  memset(&record, 0, sizeof(record));
+  record.id = 7;
+  record.timestamp = 0x00012345;
+  record.values[2] = -3;
+  record.flags = 0x80;
+
+  const uint8_t* input = reinterpret_cast<const uint8_t*>(&record);
+  uint8_t encoded[cobs::max_encoded_size(sizeof(record))];
+  uint8_t encoded_zpe[cobs::max_zpe_encoded_size(sizeof(record))];
+  size_t encoded_length = cobs::encode_to(input, sizeof(record), encoded, sizeof(encoded));
+  size_t encoded_zpe_length = cobs::encode_zpe_to(input, sizeof(record), encoded_zpe, sizeof(encoded_zpe));
+  printf("COBS: %lu bytes, COBS/ZPE: %lu bytes for a %lu byte record\n", (unsigned long)encoded_length,
+    (unsigned long)encoded_zpe_length, (unsigned long)sizeof(record));
+  ASSERT_EQUAL_LUINT(encoded_zpe_length < sizeof(record), true);
+  ASSERT_EQUAL_LUINT(encoded_zpe_length * 3 < encoded_length * 2, true);
+
+  // Without zeros the size is the same up to 223 bytes
+  uint8_t data[223];
+  uint8_t output[cobs::max_encoded_size(sizeof(data))];
+  memset(data, 0x55, sizeof(data));
+  encoded_length = cobs::encode_to(data, sizeof(data), output, sizeof(output));
+  ASSERT_EQUAL_LUINT(cobs::encode_zpe_to(data, sizeof(data), output, sizeof(output)), encoded_length);
+
+  return true;
+}
+
+bool test_decode_zpe_to_invalid(void)
+{
+  uint8_t output[16];
+  uint8_t zero_code[] = {0x02, 0x11, 0x00, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::decode_zpe_to(zero_code, sizeof(zero_code), output, sizeof(output)), 0);
+  uint8_t truncated[] = {0xE5, 0x11, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::decode_zpe_to(truncated, sizeof(truncated), output, sizeof(output)), 0);
+  uint8_t full[] = {0xE0, 0x11};
+  ASSERT_EQUAL_LUINT(cobs::decode_zpe_to(full, sizeof(full), output, sizeof(output)), 0);
+  // The zeros must fit into the output buffer as well
+  uint8_t zeros[] = {0xE1, 0xE1, 0xE1};
+  ASSERT_EQUAL_LUINT(cobs::decode_zpe_to(zeros, sizeof(zeros), output, 5), 5);
+  ASSERT_EQUAL_LUINT(cobs::decode_zpe_to(zeros, sizeof(zeros), output, 4), 0);
+
+  return true;
+}
+
+bool test_crc(void)
+{
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  ASSERT_EQUAL_LUINT(cobs::Crc16::compute(check, sizeof(check)), 0x29B1);
+  ASSERT_EQUAL_LUINT(cobs::Crc32::compute(check, sizeof(check)), 0xCBF43926);
+
+  // The constant lookup tables must match the polynomials
+  for (unsigned int i = 0; i < 256; i++) {
+    ASSERT_EQUAL_LUINT(cobs::Crc16::lookup(i), cobs::Crc16::table_entry(i));
+    ASSERT_EQUAL_LUINT(cobs::Crc32::lookup(i), cobs::Crc32::table_entry(i));
+  }
+
+  return true;
+}
+
+template <typename Crc>
+static bool check_encode_decode_crc(const uint8_t* input, const size_t size)
+{
+  static uint8_t expected_input[1024];
+  static uint8_t expected_output[cobs::max_encoded_size(sizeof(expected_input))];
+  static uint8_t encoded[sizeof(expected_output)];
+  static uint8_t output[sizeof(expected_input)];
+
+  // The output is the same as encoding the data with the checksum appended
+  memcpy(expected_input, input, size);
+  Crc::store(Crc::compute(input, size), &expected_input[size]);
+  size_t expected_length = cobs::encode_to(expected_input, size + Crc::size, expected_output, sizeof(expected_output));
+  size_t encoded_length = cobs::encode_crc_to<Crc>(input, size, encoded, cobs::max_encoded_size(size + Crc::size));
+  ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+  ASSERT_EQUAL_MEM(encoded, expected_output, encoded_length);
+
+  cobs::Status status = cobs::Status::ZERO_CODE;
+  size_t decoded_length = cobs::decode_crc_to<Crc>(encoded, encoded_length, output, size + Crc::size, &status);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OK, true);
+  ASSERT_EQUAL_LUINT(decoded_length, size);
+  ASSERT_EQUAL_MEM(output, input, size);
+
+  return true;
+}
+
+bool test_encode_decode_crc_all_sizes(void)
+{
+  printf("Encoding and decoding frames with CRC-16 and CRC-32:\n");
+  uint8_t input[1000];
+  srand(42);
+  for (size_t size = 0; size <= sizeof(input); size++) {
+    for (size_t i = 0; i < size; i++) {
+      input[i] = size % 2 ? rand() % 256 : rand() % 255 + 1;  // Long groups for even sizes
+    }
+    if (not check_encode_decode_crc<cobs::Crc16>(input, size) or not check_encode_decode_crc<cobs::Crc32>(input, size))
+      return false;
+  }
+
+  return true;
+}
+
+bool test_decode_crc_errors(void)
+{
+  uint8_t input[300];
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    input[i] = i % 7 ? i : 0x00;
+  }
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input) + cobs::Crc32::size)];
+  uint8_t output[sizeof(input) + cobs::Crc32::size];
+  cobs::Status status;
+  size_t encoded_length = cobs::encode_crc_to<cobs::Crc32>(input, sizeof(input), encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(cobs::encode_crc_to<cobs::Crc32>(input, sizeof(input), encoded, sizeof(encoded) - 1), 0);
+
+  // A corrupted data byte is only detected by the checksum
+  encoded[100] ^= 0x01;
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc32>(encoded, encoded_length, output, sizeof(output), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::CRC_MISMATCH, true);
+  encoded[100] ^= 0x01;
+
+  // The CRC-16 checksum does not match a CRC-32 trailer
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc16>(encoded, encoded_length, output, sizeof(output), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::CRC_MISMATCH, true);
+
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc32>(encoded, encoded_length, output, sizeof(output) - 1, &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OVERSIZE, true);
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc32>(encoded, encoded_length - 1, output, sizeof(output), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OUT_OF_RANGE, true);
+  encoded[0] = 0x00;
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc32>(encoded, encoded_length, output, sizeof(output), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::ZERO_CODE, true);
+
+  // A frame shorter than the checksum
+  uint8_t short_frame[] = {0x02, 0x11};
+  ASSERT_EQUAL_LUINT(cobs::decode_crc_to<cobs::Crc16>(short_frame, sizeof(short_frame), output, sizeof(output), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::CRC_MISMATCH, true);
+
+  // An empty frame is valid
+  encoded_length = cobs::encode_crc_to<cobs::Crc16, 0x7E>(input, 0, encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(memchr(encoded, 0x7E, encoded_length) == NULL, true);
+  size_t decoded_length = cobs::decode_crc_to<cobs::Crc16, 0x7E>(encoded, encoded_length, output, sizeof(output), &status);
+  ASSERT_EQUAL_LUINT(decoded_length, 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OK, true);
+
+  return true;
+}
+
+bool test_validate(void)
+{
+  printf("Validating frames of all sizes:\n");
+  uint8_t input[600];
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  uint8_t copy[sizeof(encoded)];
+  uint8_t output[sizeof(input)];
+  srand(42);
+  for (size_t size = 0; size <= sizeof(input); size++) {
+    for (size_t i = 0; i < size; i++) {
+      input[i] = size % 2 ? rand() % 256 : rand() % 255 + 1;
+    }
+    size_t encoded_length = cobs::encode_to(input, size, encoded, sizeof(encoded));
+    memcpy(copy, encoded, encoded_length);
+    cobs::Status status = cobs::Status::ZERO_CODE;
+    ASSERT_EQUAL_LUINT(cobs::validate(encoded, encoded_length, &status), size);
+    ASSERT_EQUAL_LUINT(status == cobs::Status::OK, true);
+    ASSERT_EQUAL_MEM(encoded, copy, encoded_length);
+    ASSERT_EQUAL_LUINT(cobs::decode_to(encoded, encoded_length, output, sizeof(output)), size);
+
+    encoded_length = cobs::encode_to<0x7E>(input, size, encoded, sizeof(encoded));
+    ASSERT_EQUAL_LUINT(cobs::validate<0x7E>(encoded, encoded_length), size);
+  }
+
+  return true;
+}
+
+bool test_validate_invalid(void)
+{
+  cobs::Status status;
+  uint8_t zero_code[] = {0x02, 0x11, 0x00, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::validate(zero_code, sizeof(zero_code), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::ZERO_CODE, true);
+
+  // The decoder would accept this frame, but the data contains the delimiter
+  uint8_t delimiter[] = {0x04, 0x11, 0x00, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::validate(delimiter, sizeof(delimiter), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::DELIMITER, true);
+
+  uint8_t out_of_range[] = {0x02, 0x11, 0x04, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::validate(out_of_range, sizeof(out_of_range), &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OUT_OF_RANGE, true);
+
+  // A frame without a code byte is rejected like by the decoders
+  ASSERT_EQUAL_LUINT(cobs::validate(zero_code, 0, &status), 0);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OUT_OF_RANGE, true);
+
+  uint8_t valid[] = {0x02, 0x11, 0x01, 0x02, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::validate(valid, sizeof(valid), &status), 4);
+  ASSERT_EQUAL_LUINT(status == cobs::Status::OK, true);
+
+  return true;
+}
+
+/**
+ * Split the input into fragments of random size, including empty ones.
+ */
+static size_t split_fragments(const uint8_t* input, const size_t size, cobs::Fragment* fragments, const size_t maxFragments)
+{
+  size_t count = 0;
+  size_t offset = 0;
+  while (count < maxFragments - 1 and offset < size) {
+    size_t fragment_size = rand() % (rand() % 2 ? 8 : 400);
+    if (fragment_size > size - offset)
+      fragment_size = size - offset;
+    fragments[count].data = &input[offset];
+    fragments[count++].size = fragment_size;
+    offset += fragment_size;
+  }
+  fragments[count].data = &input[offset];
+  fragments[count++].size = size - offset;
+  return count;
+}
+
+bool test_encode_fragments(void)
+{
+  printf("Encoding fragmented frames:\n");
+  static uint8_t input[1200];
+  static uint8_t expected_output[cobs::max_encoded_size(sizeof(input))];
+  static uint8_t encoded[sizeof(expected_output)];
+  static uint8_t codes[sizeof(input) + 1];
+  struct iovec vectors[2 * sizeof(input) + 1];
+  cobs::Fragment fragments[64];
+  srand(42);
+  for (size_t size = 0; size <= sizeof(input); size += 7) {
+    for (size_t i = 0; i < size; i++) {
+      input[i] = size % 2 ? rand() % 256 : rand() % 255 + 1;
+    }
+    const size_t count = split_fragments(input, size, fragments, sizeof(fragments) / sizeof(fragments[0]));
+    ASSERT_EQUAL_LUINT(cobs::fragments_size(fragments, count), size);
+
+    size_t expected_length = cobs::encode_to(input, size, expected_output, sizeof(expected_output));
+    size_t encoded_length = cobs::encode_fragments_to(fragments, count, encoded, cobs::max_encoded_size(size));
+    ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+    ASSERT_EQUAL_MEM(encoded, expected_output, expected_length);
+
+    // Gather the iovec list
+    size_t vector_count = cobs::encode_fragments_iov(fragments, count, codes, sizeof(codes), vectors, sizeof(vectors) / sizeof(vectors[0]));
+    ASSERT_EQUAL_LUINT(vector_count > 0, true);
+    encoded_length = 0;
+    for (size_t i = 0; i < vector_count; i++) {
+      memcpy(&encoded[encoded_length], vectors[i].iov_base, vectors[i].iov_len);
+      encoded_length += vectors[i].iov_len;
+    }
+    ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+    ASSERT_EQUAL_MEM(encoded, expected_output, expected_length);
+  }
+
+  // With a delimiter
+  const size_t count = split_fragments(input, sizeof(input), fragments, sizeof(fragments) / sizeof(fragments[0]));
+  size_t expected_length = cobs::encode_to<0x7E>(input, sizeof(input), expected_output, sizeof(expected_output));
+  ASSERT_EQUAL_LUINT(cobs::encode_fragments_to<0x7E>(fragments, count, encoded, sizeof(encoded)), expected_length);
+  ASSERT_EQUAL_MEM(encoded, expected_output, expected_length);
+  ASSERT_EQUAL_LUINT(cobs::encode_fragments_to(fragments, count, encoded, sizeof(encoded) - 1), 0);
+
+  return true;
+}
+
+bool test_encode_fragments_writev(void)
+{
+  uint8_t header[] = {0x01, 0x00, 0x10};
+  uint8_t payload[600];
+  uint8_t trailer[] = {0xAA, 0x00};
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = i % 100 ? i : 0x00;
+  }
+  cobs::Fragment fragments[] = {{header, sizeof(header)}, {payload, sizeof(payload)}, {trailer, sizeof(trailer)}};
+  uint8_t input[sizeof(header) + sizeof(payload) + sizeof(trailer)];
+  memcpy(input, header, sizeof(header));
+  memcpy(&input[sizeof(header)], payload, sizeof(payload));
+  memcpy(&input[sizeof(header) + sizeof(payload)], trailer, sizeof(trailer));
+  uint8_t expected_output[cobs::max_encoded_size(sizeof(input))];
+  size_t expected_length = cobs::encode_to(input, sizeof(input), expected_output, sizeof(expected_output));
+
+  uint8_t codes[16];
+  struct iovec vectors[32];
+  size_t vector_count = cobs::encode_fragments_iov(fragments, 3, codes, sizeof(codes), vectors, 32);
+  ASSERT_EQUAL_LUINT(vector_count > 0, true);
+  // Not enough room for the code bytes or the list
+  ASSERT_EQUAL_LUINT(cobs::encode_fragments_iov(fragments, 3, codes, 4, vectors, 32), 0);
+  ASSERT_EQUAL_LUINT(cobs::encode_fragments_iov(fragments, 3, codes, sizeof(codes), vectors, vector_count - 1), 0);
+
+  int fds[2];
+  ASSERT_EQUAL_LUINT(pipe(fds), 0);
+  ASSERT_EQUAL_LUINT(writev(fds[1], vectors, vector_count), expected_length);
+  uint8_t output[sizeof(expected_output)];
+  ASSERT_EQUAL_LUINT(read(fds[0], output, sizeof(output)), expected_length);
+  close(fds[0]);
+  close(fds[1]);
+  ASSERT_EQUAL_MEM(output, expected_output, expected_length);
+
+  return true;
+}
+
+bool test_encode_to_ring(void)
+{
+  printf("Encoding into ring buffers:\n");
+  static uint8_t input[700];
+  static uint8_t expected_output[cobs::max_encoded_size(sizeof(input)) + 1];
+  static uint8_t ring[cobs::max_encoded_size(sizeof(input)) + 13];
+  static uint8_t output[sizeof(ring)];
+  // Ring sizes, that are not a power of two and not a multiple of the group size
+  const size_t ring_sizes[] = {7, 13, 255, 256, 257, 509, sizeof(ring)};
+  srand(42);
+  for (size_t r = 0; r < sizeof(ring_sizes) / sizeof(ring_sizes[0]); r++) {
+    const size_t ring_size = ring_sizes[r];
+    size_t head = 0;
+    size_t tail = 0;
+    // The frame and the delimiter must fit into the ring
+    size_t max_size = sizeof(input);
+    while (cobs::max_encoded_size(max_size) + 1 > ring_size)
+      max_size--;
+    for (int round = 0; round < 64; round++) {
+      const size_t size = rand() % (max_size + 1);
+      for (size_t i = 0; i < size; i++) {
+        input[i] = round % 2 ? rand() % 256 : rand() % 255 + 1;
+      }
+      size_t expected_length = cobs::encode_to(input, size, expected_output, sizeof(expected_output));
+      expected_output[expected_length++] = 0x00;
+
+      size_t encoded_length = cobs::encode_to_sink(input, size, cobs::RingSink(ring, ring_size, head));
+      ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+      ASSERT_EQUAL_LUINT(head, (tail + expected_length) % ring_size);
+
+      // Consume the frame
+      for (size_t i = 0; i < encoded_length; i++) {
+        output[i] = ring[tail];
+        tail = (tail + 1) % ring_size;
+      }
+      ASSERT_EQUAL_MEM(output, expected_output, expected_length);
+    }
+  }
+
+  // With a delimiter and a plain function as sink
+  for (size_t i = 0; i < sizeof(input); i++) {
+    input[i] = i % 300 == 299 ? 0x00 : i % 256;
+  }
+  size_t expected_length = cobs::encode_to<0x7E>(input, sizeof(input), expected_output, sizeof(expected_output));
+  expected_output[expected_length++] = 0x7E;
+  size_t encoded_length = 0;
+  auto sink = [&encoded_length](const uint8_t* data, size_t length) {
+    memcpy(&output[encoded_length], data, length);
+    encoded_length += length;
+  };
+  ASSERT_EQUAL_LUINT(cobs::encode_to_sink<0x7E>(input, sizeof(input), sink), expected_length);
+  ASSERT_EQUAL_LUINT(encoded_length, expected_length);
+  ASSERT_EQUAL_MEM(output, expected_output, expected_length);
+
+  // An empty frame may be passed as NULL. The sink only receives the code byte and the delimiter.
+  size_t calls = 0;
+  encoded_length = 0;
+  auto counting_sink = [&](const uint8_t* data, size_t length) {
+    calls++;
+    sink(data, length);
+  };
+  ASSERT_EQUAL_LUINT(cobs::encode_to_sink(static_cast<const uint8_t*>(NULL), 0, counting_sink), 2);
+  ASSERT_EQUAL_LUINT(calls, 2);
+  ASSERT_EQUAL_LUINT(output[0], 0x01);
+  ASSERT_EQUAL_LUINT(output[1], 0x00);
+  calls = 0;
+  encoded_length = 0;
+  ASSERT_EQUAL_LUINT(cobs::encode_to_sink<0x7E>(static_cast<const uint8_t*>(NULL), 0, counting_sink), 2);
+  ASSERT_EQUAL_LUINT(calls, 2);
+  ASSERT_EQUAL_LUINT(output[0], 0x01 ^ 0x7E);
+  ASSERT_EQUAL_LUINT(output[1], 0x7E);
+
+  return true;
+}
+
+/**
+ * The payload of the frame with the given sequence number. The frames have
+ * different sizes and contain zeros.
+ */
+static size_t pipeline_frame(const uint32_t sequence, uint8_t* frame)
+{
+  const size_t size = 4 + sequence % 61;
+  memcpy(frame, &sequence, 4);
+  for (size_t i = 4; i < size; i++) {
+    frame[i] = (sequence * 31 + i * 7) % 11 == 0 ? 0x00 : sequence + i;
+  }
+  return size;
+}
+
+bool test_frame_pipeline(void)
+{
+  printf("Passing frames between two threads:\n");
+  static cobs::FramePipeline<1 << 16, 64> pipeline;
+  const uint32_t frame_count = 2000000;
+
+  std::thread producer([&]() {
+    uint8_t frame[64];
+    uint8_t encoded[cobs::max_encoded_size(sizeof(frame)) + 1];
+    uint32_t seed = 1;
+    for (uint32_t sequence = 0; sequence < frame_count; sequence++) {
+      const size_t size = pipeline_frame(sequence, frame);
+      size_t encoded_length = cobs::encode_to(frame, size, encoded, sizeof(encoded));
+      encoded[encoded_length++] = 0x00;
+      // Push the frame in chunks of random size, that do not match the frame boundaries
+      for (size_t offset = 0; offset < encoded_length;) {
+        seed = seed * 1103515245 + 12345;
+        size_t chunk_size = (seed >> 16) % 32 + 1;
+        if (chunk_size > encoded_length - offset)
+          chunk_size = encoded_length - offset;
+        const size_t pushed = pipeline.push(&encoded[offset], chunk_size);
+        if (pushed == 0)
+          std::this_thread::yield();  // The ring is full
+        offset += pushed;
+      }
+    }
+  });
+
+  uint32_t expected_sequence = 0;
+  bool valid = true;
+  auto check = [&](const uint8_t* frame, size_t length) {
+    uint8_t expected_frame[64];
+    const size_t expected_length = pipeline_frame(expected_sequence++, expected_frame);
+    if (length != expected_length or memcmp(frame, expected_frame, length) != 0)
+      valid = false;
+  };
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (expected_sequence < frame_count and valid) {
+    if (pipeline.poll(check) == 0)
+      std::this_thread::yield();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  producer.join();
+  printf("%.1f million frames per second\n",
+    frame_count / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) / 1e6);
+
+  ASSERT_EQUAL_LUINT(valid, true);
+  ASSERT_EQUAL_LUINT(expected_sequence, frame_count);
+  ASSERT_EQUAL_LUINT(pipeline.discarded(), 0);
+
+  return true;
+}
+
+bool test_frame_pipeline_full(void)
+{
+  cobs::FramePipeline<16> pipeline;
+  uint8_t data[] = {0x03, 0x11, 0x22, 0x00, 0x02, 0x33, 0x00, 0x01, 0x01, 0x00, 0x02, 0x44, 0x00, 0x02, 0x55, 0x00, 0x02, 0x66, 0x00};
+  FrameLog log = {};
+  auto sink = [&log](const uint8_t* frame, size_t length) { log_frame(log, frame, length); };
+
+  // The ring only accepts 16 bytes until the consumer has caught up
+  ASSERT_EQUAL_LUINT(pipeline.push(data, sizeof(data)), 16);
+  ASSERT_EQUAL_LUINT(pipeline.push(&data[16], 3), 0);
+  ASSERT_EQUAL_LUINT(pipeline.poll(sink), 5);
+  ASSERT_EQUAL_LUINT(pipeline.poll(sink), 0);
+  ASSERT_EQUAL_LUINT(pipeline.push(&data[16], 3), 3);
+  ASSERT_EQUAL_LUINT(pipeline.poll(sink), 1);
+  ASSERT_EQUAL_LUINT(log.count, 6);
+  ASSERT_EQUAL_LUINT(log.lengths[0], 2);
+  ASSERT_EQUAL_LUINT(log.lengths[2], 1);
+  ASSERT_EQUAL_LUINT(log.data[log.size - 1], 0x66);
+
+  return true;
+}
+
+bool test_decode_as(void)
+{
+  struct Measurement {
+    uint32_t timestamp;
+    float value;
+    uint16_t channel;
+    uint8_t flags;
+  } measurement = {0x00010000, 1.5f, 3, 0x00}, decoded;
+
+  uint8_t encoded[cobs::max_encoded_size(sizeof(measurement))];
+  size_t encoded_length = cobs::encode_to(reinterpret_cast<const uint8_t*>(&measurement), sizeof(measurement), encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(cobs::decode_as(encoded, encoded_length, decoded), true);
+  ASSERT_EQUAL_LUINT(decoded.timestamp, measurement.timestamp);
+  ASSERT_EQUAL_LUINT(decoded.value == measurement.value, true);
+  ASSERT_EQUAL_LUINT(decoded.channel, measurement.channel);
+  ASSERT_EQUAL_LUINT(decoded.flags, measurement.flags);
+
+  // The frame must have exactly the size of the type
+  uint32_t small;
+  ASSERT_EQUAL_LUINT(cobs::decode_as(encoded, encoded_length, small), false);
+  uint8_t short_frame[] = {0x03, 0x11, 0x22};
+  ASSERT_EQUAL_LUINT(cobs::decode_as(short_frame, sizeof(short_frame), small), false);
+  uint8_t invalid[] = {0x03, 0x11, 0x22, 0x00, 0x33};
+  ASSERT_EQUAL_LUINT(cobs::decode_as(invalid, sizeof(invalid), small), false);
+
+  encoded_length = cobs::encode_to<0x7E>(reinterpret_cast<const uint8_t*>(&measurement), sizeof(measurement), encoded, sizeof(encoded));
+  bool valid = cobs::decode_as<Measurement, 0x7E>(encoded, encoded_length, decoded);
+  ASSERT_EQUAL_LUINT(valid, true);
+  ASSERT_EQUAL_LUINT(decoded.timestamp, measurement.timestamp);
+
+  return true;
+}
+
+/**
+ * Open a pty pair in raw mode, so the line discipline passes all bytes unmodified.
+ */
+static bool open_raw_pty(int& master, int& slave)
+{
+  if (openpty(&master, &slave, NULL, NULL, NULL) != 0)
+    return false;
+  struct termios attributes;
+  tcgetattr(slave, &attributes);
+  cfmakeraw(&attributes);
+  tcsetattr(slave, TCSANOW, &attributes);
+  tcgetattr(master, &attributes);
+  cfmakeraw(&attributes);
+  tcsetattr(master, TCSANOW, &attributes);
+  return true;
+}
+
+bool test_transport_echo(void)
+{
+  printf("Echoing frames over ptys:\n");
+  const size_t port_count = 4;
+  const uint32_t frames_per_port = 2000;
+  int masters[port_count];
+  int slaves[port_count];
+  cobs::EpollTransport<64, 1 << 16> transport;
+  for (size_t i = 0; i < port_count; i++) {
+    ASSERT_EQUAL_LUINT(open_raw_pty(masters[i], slaves[i]), true);
+    ASSERT_EQUAL_LUINT(transport.add(masters[i]), true);
+  }
+  ASSERT_EQUAL_LUINT(transport.add(masters[0]), false);
+
+  // The devices on the slave side send frames, the transport echoes them back
+  std::thread devices([&]() {
+    for (size_t i = 0; i < port_count; i++) {
+      const int flags = fcntl(slaves[i], F_GETFL);
+      fcntl(slaves[i], F_SETFL, flags | O_NONBLOCK);
+    }
+    uint8_t frame[64];
+    uint8_t encoded[cobs::max_encoded_size(sizeof(frame)) + 1];
+    for (uint32_t sequence = 0; sequence < frames_per_port; sequence++) {
+      const size_t size = pipeline_frame(sequence, frame);
+      size_t encoded_length = cobs::encode_to(frame, size, encoded, sizeof(encoded));
+      encoded[encoded_length++] = 0x00;
+      for (size_t i = 0; i < port_count; i++) {
+        for (size_t offset = 0; offset < encoded_length;) {
+          const ssize_t written = write(slaves[i], &encoded[offset], encoded_length - offset);
+          if (written > 0)
+            offset += written;
+          else
+            std::this_thread::yield();  // The pty is full
+        }
+      }
+    }
+  });
+
+  // Collect the echoed frames on the slave side
+  static cobs::StreamDecoder<64> decoders[port_count];
+  uint32_t received[port_count] = {};
+  uint32_t frame_count = 0;
+  bool valid = true;
+  size_t echoed = 0;
+  auto echo = [&](int fd, const uint8_t* frame, size_t length) {
+    if (frame == NULL or not transport.send(fd, frame, length))
+      valid = false;
+    echoed++;
+  };
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (frame_count < port_count * frames_per_port and valid) {
+    if (transport.poll(10, echo) < 0)
+      valid = false;
+    for (size_t i = 0; i < port_count; i++) {
+      uint8_t chunk[4096];
+      const ssize_t size = read(slaves[i], chunk, sizeof(chunk));
+      if (size <= 0)
+        continue;
+      decoders[i].feed(chunk, size, [&](const uint8_t* frame, size_t length) {
+        uint8_t expected_frame[64];
+        const size_t expected_length = pipeline_frame(received[i]++, expected_frame);
+        if (length != expected_length or memcmp(frame, expected_frame, length) != 0)
+          valid = false;
+        frame_count++;
+      });
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  devices.join();
+  printf("%.1f thousand frames per second\n",
+    frame_count / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) / 1e3);
+
+  ASSERT_EQUAL_LUINT(valid, true);
+  ASSERT_EQUAL_LUINT(echoed, port_count * frames_per_port);
+  for (size_t i = 0; i < port_count; i++) {
+    ASSERT_EQUAL_LUINT(received[i], frames_per_port);
+    ASSERT_EQUAL_LUINT(transport.pending(masters[i]), 0);
+    ASSERT_EQUAL_LUINT(transport.remove(masters[i]), true);
+    close(masters[i]);
+    close(slaves[i]);
+  }
+  ASSERT_EQUAL_LUINT(transport.remove(masters[0]), false);
+
+  return true;
+}
+
+bool test_transport_backpressure(void)
+{
+  // Nobody reads from the pipe, so the transmit buffer fills up
+  int fds[2];
+  ASSERT_EQUAL_LUINT(pipe(fds), 0);
+  cobs::EpollTransport<64, 256> transport;
+  ASSERT_EQUAL_LUINT(transport.add(fds[1]), true);
+  uint8_t frame[100];
+  memset(frame, 0x55, sizeof(frame));
+  auto ignore = [](int, const uint8_t*, size_t) {};
+
+  size_t sent = 0;
+  while (transport.send(fds[1], frame, sizeof(frame))) {
+    sent++;
+    transport.poll(0, ignore);
+  }
+  ASSERT_EQUAL_LUINT(sent > 0, true);
+  ASSERT_EQUAL_LUINT(transport.pending(fds[1]) > 256 - (cobs::max_encoded_size(sizeof(frame)) + 1), true);
+  ASSERT_EQUAL_LUINT(transport.send(-1, frame, sizeof(frame)), false);
+
+  // Drain the pipe, the transport writes the remaining frames
+  const int flags = fcntl(fds[0], F_GETFL);
+  fcntl(fds[0], F_SETFL, flags | O_NONBLOCK);
+  cobs::StreamDecoder<128> decoder;
+  size_t received = 0;
+  bool valid = true;
+  auto count = [&](const uint8_t* data, size_t length) {
+    if (length != sizeof(frame) or memcmp(data, frame, length) != 0)
+      valid = false;
+    received++;
+  };
+  while (transport.pending(fds[1]) > 0 or received < sent) {
+    uint8_t chunk[4096];
+    const ssize_t size = read(fds[0], chunk, sizeof(chunk));
+    if (size > 0)
+      decoder.feed(chunk, size, count);
+    ASSERT_EQUAL_LUINT(transport.poll(10, ignore) >= 0, true);
+  }
+  ASSERT_EQUAL_LUINT(valid, true);
+  ASSERT_EQUAL_LUINT(received, sent);
+  close(fds[0]);
+  close(fds[1]);
+
+  return true;
+}
+
+bool test_transport_hangup(void)
+{
+  int master, slave;
+  ASSERT_EQUAL_LUINT(open_raw_pty(master, slave), true);
+  cobs::EpollTransport<> transport;
+  ASSERT_EQUAL_LUINT(transport.add(master), true);
+  uint8_t frame[] = {0x03, 0x11, 0x22, 0x02, 0x33, 0x00};
+  ASSERT_EQUAL_LUINT(write(slave, frame, sizeof(frame)), sizeof(frame));
+  close(slave);
+
+  // The frame written before the hang up is still delivered
+  FrameLog log = {};
+  int hangups = 0;
+  auto sink = [&](int fd, const uint8_t* data, size_t length) {
+    if (data == NULL)
+      hangups++;
+    else
+      log_frame(log, data, length);
+  };
+  for (int i = 0; i < 10 and hangups == 0; i++) {
+    ASSERT_EQUAL_LUINT(transport.poll(100, sink) >= 0, true);
+  }
+  ASSERT_EQUAL_LUINT(log.count, 1);
+  ASSERT_EQUAL_LUINT(log.lengths[0], 4);
+  ASSERT_EQUAL_LUINT(hangups, 1);
+  // The port was removed
+  ASSERT_EQUAL_LUINT(transport.send(master, frame, sizeof(frame)), false);
+  ASSERT_EQUAL_LUINT(transport.remove(master), false);
+  close(master);
+
+  return true;
+}
+
+bool test_frame_pool(void)
+{
+  static cobs::FramePool<4> pool;
+  ASSERT_EQUAL_LUINT(pool.available(), 4);
+  uint8_t* slots[5];
+  for (size_t i = 0; i < 5; i++) {
+    slots[i] = pool.acquire();
+  }
+  ASSERT_EQUAL_LUINT(slots[3] != NULL, true);
+  ASSERT_EQUAL_LUINT(slots[4] == NULL, true);
+  ASSERT_EQUAL_LUINT(pool.available(), 0);
+  // The slots do not overlap
+  for (size_t i = 0; i < 4; i++) {
+    memset(slots[i], i, cobs::FramePool<4>::SLOT_SIZE);
+  }
+  for (size_t i = 0; i < 4; i++) {
+    ASSERT_EQUAL_LUINT(slots[i][0], i);
+    ASSERT_EQUAL_LUINT(slots[i][254], i);
+  }
+  pool.release(slots[1]);
+  pool.release(slots[2]);
+  ASSERT_EQUAL_LUINT(pool.available(), 2);
+  ASSERT_EQUAL_LUINT(pool.acquire() == slots[2], true);
+  pool.release(slots[0]);
+  pool.release(slots[2]);
+  pool.release(slots[3]);
+  ASSERT_EQUAL_LUINT(pool.available(), 4);
+
+  // Decode straight into a slot
+  uint8_t input[254];
+  for (size_t i = 0; i < sizeof(input); i++) {
+    input[i] = i % 9 ? i : 0x00;
+  }
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  size_t encoded_length = cobs::encode_to<0x7E>(input, sizeof(input), encoded, sizeof(encoded));
+  size_t length = 0;
+  uint8_t* frame = cobs::decode_to_pool<0x7E>(pool, encoded, encoded_length, length);
+  ASSERT_EQUAL_LUINT(frame != NULL, true);
+  ASSERT_EQUAL_LUINT(length, sizeof(input));
+  ASSERT_EQUAL_MEM(frame, input, sizeof(input));
+  ASSERT_EQUAL_LUINT(pool.available(), 3);
+  // Invalid frames and frames larger than a slot do not use up a slot
+  ASSERT_EQUAL_LUINT(cobs::decode_to_pool(pool, encoded, encoded_length, length) == NULL, true);
+  cobs::FramePool<1, 16> small_pool;
+  encoded_length = cobs::encode_to(input, 17, encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(cobs::decode_to_pool(small_pool, encoded, encoded_length, length) == NULL, true);
+  ASSERT_EQUAL_LUINT(small_pool.available(), 1);
+  encoded_length = cobs::encode_to(input, 16, encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(cobs::decode_to_pool(small_pool, encoded, encoded_length, length) != NULL, true);
+  ASSERT_EQUAL_LUINT(cobs::decode_to_pool(small_pool, encoded, encoded_length, length) == NULL, true);
+  pool.release(frame);
+  ASSERT_EQUAL_LUINT(pool.available(), 4);
+
+  return true;
+}
+
+bool test_concurrent_frame_pool(void)
+{
+  printf("Sharing a frame pool between threads:\n");
+  const size_t slot_count = 64;
+  static cobs::ConcurrentFramePool<slot_count> pool;
+  const unsigned int thread_count = 4;
+  const uint32_t rounds = 500000;
+  std::atomic<bool> valid(true);
+
+  // Every thread holds up to 8 slots at a time and checks, that nobody else
+  // writes to them
+  auto worker = [&](const uint8_t id) {
+    uint8_t* held[8] = {};
+    for (uint32_t round = 0; round < rounds; round++) {
+      uint8_t*& slot = held[round % 8];
+      if (slot != NULL) {
+        if (slot[0] != id or slot[cobs::ConcurrentFramePool<slot_count>::SLOT_SIZE - 1] != id)
+          valid = false;
+        pool.release(slot);
+      }
+      slot = pool.acquire();
+      if (slot == NULL) {
+        valid = false;
+        break;
+      }
+      slot[0] = id;
+      slot[cobs::ConcurrentFramePool<slot_count>::SLOT_SIZE - 1] = id;
+    }
+    for (size_t i = 0; i < 8; i++) {
+      if (held[i] != NULL)
+        pool.release(held[i]);
+    }
+  };
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  std::thread threads[thread_count];
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads[i] = std::thread(worker, i + 1);
+  }
+  for (unsigned int i = 0; i < thread_count; i++) {
+    threads[i].join();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("%.1f million slots per second\n",
+    thread_count * rounds / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) / 1e6);
+  ASSERT_EQUAL_LUINT(valid.load(), true);
+
+  // All slots were returned
+  uint8_t* slots[slot_count];
+  for (size_t i = 0; i < slot_count; i++) {
+    slots[i] = pool.acquire();
+    ASSERT_EQUAL_LUINT(slots[i] != NULL, true);
+  }
+  ASSERT_EQUAL_LUINT(pool.acquire() == NULL, true);
+  for (size_t i = 0; i < slot_count; i++) {
+    pool.release(slots[i]);
+  }
+
+  // Decode straight into a slot
+  const uint8_t input[] = {0x11, 0x00, 0x22};
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  const size_t encoded_length = cobs::encode_to(input, sizeof(input), encoded, sizeof(encoded));
+  size_t length = 0;
+  uint8_t* frame = cobs::decode_to_pool(pool, encoded, encoded_length, length);
+  ASSERT_EQUAL_LUINT(frame != NULL, true);
+  ASSERT_EQUAL_LUINT(length, sizeof(input));
+  ASSERT_EQUAL_MEM(frame, input, sizeof(input));
+  pool.release(frame);
+
+  return true;
+}
+
+#ifdef __cpp_impl_coroutine
+/**
+ * Count all heap allocations, including the coroutine frames of the library,
+ * while counting is enabled. The replacements come in matching pairs, so every
+ * operator delete frees, what the corresponding operator new allocated.
+ */
+static bool count_allocations = false;
+static size_t allocation_count = 0;
+static size_t deallocation_count = 0;
+
+// The replacements are not inlined, otherwise GCC sees free() called on the
+// result of operator new and warns about a mismatch (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size)
+{
+  if (count_allocations)
+    allocation_count++;
+  void* memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL)
+    throw std::bad_alloc();
+  return memory;
+}
+__attribute__((noinline)) void* operator new[](size_t size) { return operator new(size); }
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+  if (count_allocations and memory != NULL)
+    deallocation_count++;
+  free(memory);
+}
+__attribute__((noinline)) void operator delete[](void* memory) noexcept { operator delete(memory); }
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept { operator delete(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, size_t) noexcept { operator delete(memory); }
+
+/**
+ * A coroutine, that starts immediately and frees itself when done.
+ */
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/**
+ * An in-memory connection, that is both an asynchronous sink and source. The
+ * data is only passed on and the waiting coroutines are only resumed by pump(),
+ * like an event loop would.
+ */
+class MemoryPipe {
+  public:
+    size_t writable() const { return closed ? 0 : sizeof(buffer) - used; }
+    void write(const uint8_t* data, size_t length) {
+      memcpy(&buffer[used], data, length);
+      used += length;
+    }
+    void wait(size_t size, std::coroutine_handle<> continuation) {
+      writer = continuation;
+      writerSize = size;
+    }
+    void close() { closed = true; }
+
+    struct Read {
+      bool await_ready() const { return false; }
+      void await_suspend(std::coroutine_handle<> continuation) {
+        pipe.reader = continuation;
+        pipe.readBuffer = buffer;
+        pipe.readCapacity = capacity;
+      }
+      size_t await_resume() const { return pipe.readSize; }
+
+      MemoryPipe& pipe;
+      uint8_t* buffer;
+      size_t capacity;
+    };
+    Read read(uint8_t* buffer, size_t capacity) { return Read{*this, buffer, capacity}; }
+
+    /**
+     * Pass at most max_chunk bytes to the reader and wake up the writer, if there is room.
+     * @return False if nothing happened
+     */
+    bool pump(size_t max_chunk) {
+      bool progress = false;
+      if (reader and (used > 0 or closed)) {
+        size_t size = used < readCapacity ? used : readCapacity;
+        if (size > max_chunk)
+          size = max_chunk;
+        memcpy(readBuffer, buffer, size);
+        memmove(buffer, &buffer[size], used - size);
+        used -= size;
+        readSize = size;
+        std::coroutine_handle<> continuation = reader;
+        reader = nullptr;
+        continuation.resume();
+        progress = true;
+      }
+      if (writer and (closed or writable() >= writerSize)) {
+        std::coroutine_handle<> continuation = writer;
+        writer = nullptr;
+        continuation.resume();
+        progress = true;
+      }
+      return progress;
+    }
+
+  private:
+    uint8_t buffer[256];
+    size_t used = 0;
+    bool closed = false;
+    std::coroutine_handle<> reader;
+    uint8_t* readBuffer = NULL;
+    size_t readCapacity = 0;
+    size_t readSize = 0;
+    std::coroutine_handle<> writer;
+    size_t writerSize = 0;
+};
+
+struct Connection {
+  MemoryPipe pipe;
+  uint32_t received;
+  bool valid;
+  bool finished;
+};
+
+static Task send_frames(Connection& connection, const uint32_t frame_count)
+{
+  uint8_t frame[64];
+  for (uint32_t sequence = 0; sequence < frame_count; sequence++) {
+    const size_t size = pipeline_frame(sequence, frame);
+    if (co_await cobs::async_send(connection.pipe, frame, size) == 0)
+      connection.valid = false;
+  }
+  connection.pipe.close();
+}
+
+static Task receive_frames(Connection& connection)
+{
+  cobs::AsyncFrames frames = cobs::async_frames<128>(connection.pipe);
+  while (const cobs::FrameView* frame = co_await frames.next()) {
+    uint8_t expected_frame[64];
+    const size_t expected_length = pipeline_frame(connection.received++, expected_frame);
+    if (frame->size != expected_length or memcmp(frame->data, expected_frame, expected_length) != 0)
+      connection.valid = false;
+  }
+  connection.finished = true;
+}
+
+bool test_async_frames(void)
+{
+  printf("Sending frames over many coroutine connections:\n");
+  const size_t connection_count = 1000;
+  const uint32_t frame_count = 200;
+  static Connection connections[connection_count];
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  srand(42);
+  allocation_count = deallocation_count = 0;
+  count_allocations = true;
+  for (size_t i = 0; i < connection_count; i++) {
+    connections[i].valid = true;
+    receive_frames(connections[i]);
+    send_frames(connections[i], frame_count);
+  }
+
+  // Run the event loop until all connections are done
+  for (bool progress = true; progress;) {
+    progress = false;
+    for (size_t i = 0; i < connection_count; i++) {
+      progress |= connections[i].pipe.pump(rand() % 100 + 1);
+    }
+  }
+  count_allocations = false;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  // Every connection allocates three coroutine frames: the receiving and the
+  // sending task and the generator of async_frames(). Nothing is allocated per
+  // frame and everything is freed, when the connections are done.
+  ASSERT_EQUAL_LUINT(allocation_count, 3 * connection_count);
+  ASSERT_EQUAL_LUINT(deallocation_count, 3 * connection_count);
+  printf("%.1f million frames per second\n",
+    connection_count * frame_count / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) / 1e6);
+
+  for (size_t i = 0; i < connection_count; i++) {
+    ASSERT_EQUAL_LUINT(connections[i].valid, true);
+    ASSERT_EQUAL_LUINT(connections[i].finished, true);
+    ASSERT_EQUAL_LUINT(connections[i].received, frame_count);
+  }
+
+  return true;
+}
+
+static Task receive_delimited_frames(Connection& connection, FrameLog& log)
+{
+  cobs::AsyncFrames frames = cobs::async_frames<16, 0x7E>(connection.pipe);
+  while (const cobs::FrameView* frame = co_await frames.next()) {
+    log_frame(log, frame->data, frame->size);
+  }
+  connection.finished = true;
+}
+
+bool test_async_frames_invalid(void)
+{
+  static Connection connection;
+  FrameLog log = {};
+  receive_delimited_frames(connection, log);
+
+  uint8_t large[20];
+  memset(large, 0x44, sizeof(large));
+  const uint8_t frame[] = {0x11, 0x00, 0x22};
+  uint8_t encoded[16];
+  size_t encoded_length = cobs::encode_to<0x7E>(frame, sizeof(frame), encoded, sizeof(encoded));
+  encoded[encoded_length++] = 0x7E;
+  const uint8_t out_of_range[] = {0x05 ^ 0x7E, 0x11 ^ 0x7E, 0x7E};
+  uint8_t empty[] = {0x7E, 0x7E};
+  // An empty frame, a frame too large for the buffer, which swallows the
+  // following frame up to its delimiter, an invalid frame and a valid frame
+  connection.pipe.write(empty, sizeof(empty));
+  connection.pipe.write(large, sizeof(large));
+  connection.pipe.write(encoded, encoded_length);
+  connection.pipe.write(out_of_range, sizeof(out_of_range));
+  connection.pipe.write(encoded, encoded_length);
+  connection.pipe.close();
+  while (connection.pipe.pump(7)) {}
+
+  ASSERT_EQUAL_LUINT(connection.finished, true);
+  ASSERT_EQUAL_LUINT(log.count, 1);
+  ASSERT_EQUAL_LUINT(log.lengths[0], sizeof(frame));
+  ASSERT_EQUAL_MEM(log.data, frame, sizeof(frame));
+
+  // A closed sink does not accept frames
+  Connection closed;
+  closed.pipe.close();
+  closed.valid = true;
+  send_frames(closed, 1);
+  ASSERT_EQUAL_LUINT(closed.pipe.pump(1), true);
+  ASSERT_EQUAL_LUINT(closed.valid, false);
+
+  return true;
+}
+#endif
+
+#ifdef COBS_STATS
+bool test_statistics(void)
+{
+  cobs::reset_statistics();
+  cobs::Statistics statistics;
+
+  uint8_t input[300];
+  for (unsigned int i = 0; i < sizeof(input); i++) {
+    input[i] = i % 100 ? i : 0x00;
+  }
+  uint8_t encoded[cobs::max_encoded_size(sizeof(input))];
+  uint8_t output[sizeof(input)];
+  size_t encoded_length = cobs::encode_to(input, sizeof(input), encoded, sizeof(encoded));
+  ASSERT_EQUAL_LUINT(cobs::decode_to(encoded, encoded_length, output, sizeof(output)), sizeof(input));
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.encodedFrames.load(), 1);
+  ASSERT_EQUAL_LUINT(statistics.encodedBytesIn.load(), sizeof(input));
+  ASSERT_EQUAL_LUINT(statistics.encodedBytesOut.load(), encoded_length);
+  ASSERT_EQUAL_LUINT(statistics.decodedFrames.load(), 1);
+  ASSERT_EQUAL_LUINT(statistics.decodedBytesIn.load(), encoded_length);
+  ASSERT_EQUAL_LUINT(statistics.decodedBytesOut.load(), sizeof(input));
+#ifdef COBS_STATS_HISTOGRAM
+  // 300 bytes are in the bucket [256, 512), the 4 groups in the bucket [4, 8)
+  ASSERT_EQUAL_LUINT(statistics.frameSizes[9].load(), 2);
+  ASSERT_EQUAL_LUINT(statistics.groupCounts[3].load(), 1);
+  // Large values end up in the last bucket
+  ASSERT_EQUAL_LUINT(cobs::Statistics::bucket(0x7FFF), 15);
+  ASSERT_EQUAL_LUINT(cobs::Statistics::bucket(0x8000), 16);
+  ASSERT_EQUAL_LUINT(cobs::Statistics::bucket((size_t)-1), 16);
+#endif
+
+  // The error causes are counted separately
+  ASSERT_EQUAL_LUINT(cobs::decode_to(encoded, encoded_length, output, sizeof(output) - 1), 0);
+  ASSERT_EQUAL_LUINT(cobs::decode_to(encoded, encoded_length - 1, output, sizeof(output)), 0);
+  encoded[0] = 0x00;
+  ASSERT_EQUAL_LUINT(cobs::decode_to(encoded, encoded_length, output, sizeof(output)), 0);
+  uint8_t block[] = {0x02, 0x11, 0x00};
+  ASSERT_EQUAL_LUINT(cobs::decode(block, sizeof(block)), 0);
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.error_count(cobs::Status::OVERSIZE), 1);
+  ASSERT_EQUAL_LUINT(statistics.error_count(cobs::Status::OUT_OF_RANGE), 1);
+  ASSERT_EQUAL_LUINT(statistics.error_count(cobs::Status::ZERO_CODE), 2);
+  ASSERT_EQUAL_LUINT(statistics.decodedFrames.load(), 1);
+
+  // An empty buffer is not an oversized frame
+  ASSERT_EQUAL_LUINT(cobs::encode(block, 0), 0);
+  ASSERT_EQUAL_LUINT(cobs::decode(block, 0), 0);
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.error_count(cobs::Status::OVERSIZE), 1);
+  ASSERT_EQUAL_LUINT(statistics.error_count(cobs::Status::OUT_OF_RANGE), 3);
+
+  // An empty frame is not an error
+  uint8_t empty[] = {0xAA};
+  ASSERT_EQUAL_LUINT(cobs::encode(empty, 1), 1);
+  ASSERT_EQUAL_LUINT(cobs::decode(empty, 1), 0);
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.decodedFrames.load(), 2);
+#ifdef COBS_STATS_HISTOGRAM
+  ASSERT_EQUAL_LUINT(statistics.frameSizes[0].load(), 2);
+#endif
+#ifdef COBS_STATS_TIMING
+  ASSERT_EQUAL_LUINT(statistics.encodeNanoseconds.load() > 0, true);
+  ASSERT_EQUAL_LUINT(statistics.decodeNanoseconds.load() > 0, true);
+#endif
+
+  // Every thread counts separately, the counts of all threads are summed up,
+  // including those of threads, which have already exited
+  std::atomic<bool> counted(false);
+  std::atomic<bool> done(false);
+  std::thread worker([&]() {
+    uint8_t frame[] = {0x01, 0x02, 0x03};
+    uint8_t frame_encoded[cobs::max_encoded_size(sizeof(frame))];
+    for (int i = 0; i < 10; i++) {
+      cobs::encode_to(frame, sizeof(frame), frame_encoded, sizeof(frame_encoded));
+    }
+    counted = true;
+    while (not done) {
+      std::this_thread::yield();
+    }
+  });
+  while (not counted) {
+    std::this_thread::yield();
+  }
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.encodedFrames.load(), 12);
+  done = true;
+  worker.join();
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.encodedFrames.load(), 12);
+  ASSERT_EQUAL_LUINT(statistics.encodedBytesIn.load(), sizeof(input) + 10 * 3);
+  cobs::reset_statistics();
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.encodedFrames.load(), 0);
+
+  // The stream decoder has its own statistics
+  cobs::StreamDecoder<8> decoder;
+  uint8_t stream[] = {0x03, 0x11, 0x22, 0x00, 0x03, 0x11, 0x00, 0x0A, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0x00};
+  decoder.feed(stream, sizeof(stream), [](const uint8_t*, size_t) {});
+  ASSERT_EQUAL_LUINT(decoder.statistics().decodedFrames.load(), 1);
+  ASSERT_EQUAL_LUINT(decoder.statistics().decodedBytesIn.load(), 3);
+  ASSERT_EQUAL_LUINT(decoder.statistics().error_count(cobs::Status::OUT_OF_RANGE), 1);
+  ASSERT_EQUAL_LUINT(decoder.statistics().error_count(cobs::Status::OVERSIZE), 1);
+  cobs::collect_statistics(statistics);
+  ASSERT_EQUAL_LUINT(statistics.decodedFrames.load(), 0);
+
+  // So do the decoders of the pipeline and the transport
+  cobs::FramePipeline<64, 8> pipeline;
+  ASSERT_EQUAL_LUINT(pipeline.push(stream, sizeof(stream)), sizeof(stream));
+  ASSERT_EQUAL_LUINT(pipeline.poll([](const uint8_t*, size_t) {}), 1);
+  ASSERT_EQUAL_LUINT(pipeline.statistics().decodedFrames.load(), 1);
+  ASSERT_EQUAL_LUINT(pipeline.statistics().error_count(cobs::Status::OVERSIZE), 1);
+
+  int sockets[2];
+  ASSERT_EQUAL_LUINT(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+  cobs::EpollTransport<8> transport;
+  ASSERT_EQUAL_LUINT(transport.add(sockets[0]), true);
+  ASSERT_EQUAL_LUINT(transport.statistics(sockets[1]) == NULL, true);
+  ASSERT_EQUAL_LUINT(write(sockets[1], stream, sizeof(stream)), sizeof(stream));
+  ASSERT_EQUAL_LUINT(transport.poll(1000, [](int, const uint8_t*, size_t) {}), 1);
+  ASSERT_EQUAL_LUINT(transport.statistics(sockets[0])->decodedFrames.load(), 1);
+  ASSERT_EQUAL_LUINT(transport.statistics(sockets[0])->error_count(cobs::Status::OVERSIZE), 1);
+  transport.remove(sockets[0]);
+  close(sockets[0]);
+  close(sockets[1]);
+
+  return true;
+}
+#endif
+
 int main(int argc, char*argv[])
 {
   printf("Testing encoder...\n");
@@ -424,6 +2642,11 @@ int main(int argc, char*argv[])
   test_encode_one_zeros();
   test_encode_254_bytes_non_zero();
   test_encode_255_bytes_fail();
+  test_encode_kernels_random();
+  test_encode_decode_fixed_size();
+#if __cplusplus >= 201402L
+  test_encode_frame();
+#endif
   printf("Done!\n");
 
   // Test the decoder
@@ -436,5 +2659,92 @@ int main(int argc, char*argv[])
   test_encode_decode_byte_code();
   test_decode_invalid();
   printf("Done!\n");
+
+  printf("Testing COBS/R encoder/decoder...\n");
+  test_encode_reduced();
+  test_encode_decode_reduced_all_sizes();
+  test_decode_reduced_invalid();
+  printf("Done!\n");
+
+  printf("Testing COBS/ZPE encoder/decoder...\n");
+  test_encode_zpe_to();
+  test_encode_decode_zpe_to_all_sizes();
+  test_zpe_size();
+  test_decode_zpe_to_invalid();
+  printf("Done!\n");
+
+  printf("Testing out of place encoder/decoder...\n");
+  test_max_encoded_size();
+  test_encode_to_empty();
+  test_encode_to_255_bytes_non_zero();
+  test_encode_to_buffer_too_small();
+  test_encode_to_matches_encode();
+  test_encode_decode_to_multi_block();
+  test_encode_decode_to_all_sizes();
+  test_decode_to_invalid();
+  test_decode_to_random_corruption();
+  test_validate();
+  test_validate_invalid();
+  test_decode_as();
+  test_encode_fragments();
+  test_encode_fragments_writev();
+  test_encode_to_parallel();
+  test_encode_decode_delimiter();
+  printf("Done!\n");
+
+  printf("Testing encoder/decoder with checksum...\n");
+  test_crc();
+  test_encode_decode_crc_all_sizes();
+  test_decode_crc_errors();
+  printf("Done!\n");
+
+  printf("Testing in place multi-block encoder/decoder...\n");
+  test_encode_in_place_matches_encode();
+  test_encode_in_place_headroom_too_small();
+  test_encode_in_place_matches_encode_to();
+  test_encode_decode_in_place_all_sizes();
+  printf("Done!\n");
+
+  printf("Testing stream decoder...\n");
+  test_stream_decoder_chunks();
+  test_stream_decoder_invalid();
+  test_stream_encoder_chunks();
+  test_stream_delimiter();
+  test_encode_to_ring();
+  test_frame_pipeline_full();
+  test_frame_pipeline();
+  printf("Done!\n");
+
+  printf("Testing frame pools...\n");
+  test_frame_pool();
+  test_concurrent_frame_pool();
+  printf("Done!\n");
+
+  printf("Testing transport...\n");
+  test_transport_hangup();
+  test_transport_backpressure();
+  test_transport_echo();
+  printf("Done!\n");
+
+  printf("Testing batch decoder...\n");
+  test_decode_frames();
+  test_decode_frames_table_full();
+  test_decode_frames_parallel();
+  test_decode_frames_parallel_long_tail();
+  test_mapped_file();
+  printf("Done!\n");
+
+#ifdef __cpp_impl_coroutine
+  printf("Testing coroutines...\n");
+  test_async_frames_invalid();
+  test_async_frames();
+  printf("Done!\n");
+#endif
+
+#ifdef COBS_STATS
+  printf("Testing statistics...\n");
+  test_statistics();
+  printf("Done!\n");
+#endif
   return 0;
 }
@@ -1,4 +1,24 @@
 #!/bin/bash
 #gcc -std=gnu99 cobs.cpp test.c -o test
-g++ unittest.cpp -o unit_test
+g++ -pthread unittest.cpp -o unit_test -lutil
 ./unit_test
+# Run the tests again using the scalar kernels only, the 32 and 64 bit SWAR
+# kernels and, if supported by the CPU, using the AVX2 kernels
+g++ -DCOBS_NO_SIMD -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+g++ -DCOBS_NO_SIMD -DCOBS_SWAR=4 -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+g++ -DCOBS_NO_SIMD -DCOBS_SWAR=8 -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+# With statistics enabled, with and without the optional parts
+g++ -DCOBS_STATS -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+g++ -DCOBS_STATS -DCOBS_STATS_TIMING -DCOBS_STATS_HISTOGRAM -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+# With C++20 coroutines
+g++ -std=c++20 -pthread unittest.cpp -o unit_test -lutil
+./unit_test
+if grep -q avx2 /proc/cpuinfo 2>/dev/null; then
+  g++ -mavx2 -pthread unittest.cpp -o unit_test -lutil
+  ./unit_test
+fi
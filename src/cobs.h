@@ -26,6 +26,20 @@
 
 #include <stdint.h>  // uint8_t, etc.
 #include <stddef.h>  // size_t
+#include <string.h>  // memchr, memcpy, memmove
+#if defined(__SSE2__) and not defined(COBS_NO_SIMD)
+#include <immintrin.h>  // SSE2, AVX2
+#endif
+#ifdef COBS_STATS
+#include "cobs_stats.h"
+#else
+// Without COBS_STATS the statistics hooks are empty. See cobs_stats.h.
+#define COBS_STATS_ONLY(statement)
+#define COBS_STATS_ENCODE(size, encodedSize)
+#define COBS_STATS_DECODE(encodedSize, size, groups)
+#define COBS_STATS_ERROR(status)
+#define COBS_STATS_TIMER(counter)
+#endif
 
 namespace cobs {
     /**
@@ -34,53 +48,360 @@ namespace cobs {
      * that for 254 non-zero bytes an overhead byte has to be inserted. This means
      * copying around the remainder of the input making space for the overhead
      * byte. On the Arduino we have limited memory anway, so it is unlikely, that
-     * we will ever set the message size that high.
+     * we will ever set the message size that high. If larger frames must be
+     * encoded in place, see encode_in_place(), which requires the caller to
+     * reserve some headroom in front of the data instead.
      */
 
+    /**
+     * The result of decoding a frame. Functions, that only return a size, use
+     * 0 to signal any of the errors.
+     */
+    enum class Status : uint8_t {
+        OK = 0,
+        ZERO_CODE,  // A code byte is 0x00
+        OUT_OF_RANGE,  // A group extends beyond the end of the frame
+        OVERSIZE,  // The frame does not fit into the buffer
+        CRC_MISMATCH,  // The checksum of the frame is invalid. See decode_crc_to().
+        DELIMITER,  // The frame contains the delimiter. See validate().
+    };
+
+    namespace detail {
+        /**
+         * The scalar kernel of encode(). Replaces every 0x00 in the block with
+         * the offset to the next 0x00 or the end of the block. For a delimiter
+         * other than 0x00, every byte is XORed with the delimiter while it is
+         * scanned, so there is no second pass. See copy_xor().
+         *
+         * @tparam Delimiter The byte, that does not occur in the encoded data
+         * @param buffer The i/o buffer. Index 0 must be 0x00.
+         * @param size The size of the buffer. Must be in the range 1 - 255.
+         */
+        template <uint8_t Delimiter = 0x00>
+        static inline void encode_block_scalar(uint8_t* buffer, const size_t size) {
+            uint8_t* endOfBlock = &buffer[size-1];
+
+            uint8_t* cursor;
+            do {
+                // Search for a 0x00 byte starting from the back of the stream.
+                // This is the reason why we needed to prepend the 0x00 byte to the
+                // data block. It serves as a terminator and saves us a bounds check while
+                // iterating the loop.
+                for (cursor = endOfBlock; *cursor != 0x00; cursor--) {
+                    if (Delimiter != 0x00)
+                        *cursor ^= Delimiter;
+                };
+                // 0x00 0xXX 0xXX 0xXX 0xYY 0xXX 0xXX 0xXX ....
+                //   ^             ^     ^
+                //   |             |     |
+                // cursor   endOfBlock   was 0x00
+                *cursor = (endOfBlock - cursor + 1) ^ Delimiter;  // Calculate the number of bytes until the next 0x00 byte
+                // Go to the next block and repeat
+                endOfBlock = cursor - 1;
+            } while (cursor > buffer);
+
+            // If the first data byte was 0x00, then the loop will abort after encoding
+            // this block, so we need to manually check our overhead byte. If it still
+            // says 0x00, then the loop aborted. A code byte is never 0x00, so
+            // an encoded code byte is never the delimiter.
+            if (buffer[0] == Delimiter) {
+                buffer[0] = 0x01 ^ Delimiter;
+            }
+        }
+
+        /**
+         * Encode the bytes in the range [start, end) one byte at a time, from
+         * the back to the front, and XOR them with the delimiter.
+         *
+         * @tparam Delimiter The byte, that does not occur in the encoded data
+         * @param start The first byte of the range
+         * @param end The (exclusive) end of the range
+         * @param next The position of the first 0x00 (now a code byte) behind end or the end of the block
+         * @return The position of the first 0x00 within the range or next if there is none
+         */
+        template <uint8_t Delimiter>
+        static inline uint8_t* encode_range(uint8_t* start, uint8_t* end, uint8_t* next) {
+            while (end > start) {
+                end--;
+                if (*end == 0x00) {
+                    *end = (next - end) ^ Delimiter;
+                    next = end;
+                } else if (Delimiter != 0x00) {
+                    *end ^= Delimiter;
+                }
+            }
+            return next;
+        }
+
+        /**
+         * Encode the bytes in front of the already encoded part of the block,
+         * one byte at a time. This is the tail of the vectorized kernels.
+         *
+         * @param buffer The i/o buffer. Index 0 must be 0x00.
+         * @param end The (exclusive) end of the part, that is not yet encoded
+         * @param next The position of the first 0x00 (now a code byte) behind end or the end of the block
+         */
+        template <uint8_t Delimiter>
+        static inline void encode_tail(uint8_t* buffer, uint8_t* end, uint8_t* next) {
+            encode_range<Delimiter>(buffer, end, next);
+        }
+
+        /**
+         * The SWAR (SIMD within a register) kernel of encode() for targets
+         * without a vector unit. It tests a whole word at a time for 0x00 and only
+         * encodes the words, that contain a 0x00, one byte at a time. The words are
+         * loaded from aligned addresses, the unaligned bytes at both ends of the
+         * block are encoded one at a time. The output is identical to encode_block_scalar().
+         *
+         * @tparam Word The word type, either uint32_t or uint64_t
+         * @tparam Delimiter The byte, that does not occur in the encoded data
+         * @param buffer The i/o buffer. Index 0 must be 0x00.
+         * @param size The size of the buffer. Must be in the range 1 - 255.
+         */
+        template <typename Word, uint8_t Delimiter = 0x00>
+        static inline void encode_block_swar(uint8_t* buffer, const size_t size) {
+            const Word ones = (Word)-1 / 0xFF;  // 0x01 in every byte
+            const Word highBits = ones << 7;  // 0x80 in every byte
+            uint8_t* next = buffer + size;  // The position of the next code byte
+            // Start at the last word boundary within the block
+            uint8_t* chunk = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(next) & ~(uintptr_t)(sizeof(Word) - 1));
+            if (chunk < buffer)
+                chunk = buffer;
+            next = encode_range<Delimiter>(chunk, buffer + size, next);
+            while (chunk - buffer >= (ptrdiff_t)sizeof(Word)) {
+                chunk -= sizeof(Word);
+                Word word;
+                memcpy(&word, __builtin_assume_aligned(chunk, sizeof(Word)), sizeof(Word));
+                // The classic test for a 0x00 byte within a word. It may report
+                // false positives next to a 0x00, so the word is then encoded
+                // byte by byte.
+                if (((word - ones) & ~word & highBits) != 0) {
+                    next = encode_range<Delimiter>(chunk, chunk + sizeof(Word), next);
+                } else if (Delimiter != 0x00) {
+                    word ^= ones * Delimiter;
+                    memcpy(__builtin_assume_aligned(chunk, sizeof(Word)), &word, sizeof(Word));
+                }
+            }
+            encode_tail<Delimiter>(buffer, chunk, next);
+        }
+
+#if defined(__SSE2__) and not defined(COBS_NO_SIMD)
+        /**
+         * The SSE2 kernel of encode(). It searches 16 bytes at a time for 0x00
+         * and writes the code bytes straight from the resulting bitmask. The output
+         * is identical to encode_block_scalar(). For a delimiter other than 0x00,
+         * the chunk is XORed with the delimiter, before the code bytes are written.
+         *
+         * @tparam Delimiter The byte, that does not occur in the encoded data
+         * @param buffer The i/o buffer. Index 0 must be 0x00.
+         * @param size The size of the buffer. Must be in the range 1 - 255.
+         */
+        template <uint8_t Delimiter = 0x00>
+        static inline void encode_block_sse2(uint8_t* buffer, const size_t size) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i delimiter = _mm_set1_epi8((char)Delimiter);
+            uint8_t* next = buffer + size;  // The position of the next code byte
+            uint8_t* chunk = next;
+            while (chunk - buffer >= 16) {
+                chunk -= 16;
+                const __m128i data = _mm_loadu_si128((const __m128i*)chunk);
+                unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(data, zero));
+                if (Delimiter != 0x00)
+                    _mm_storeu_si128((__m128i*)chunk, _mm_xor_si128(data, delimiter));
+                // Walk the 0x00 bytes from the back of the chunk
+                while (mask != 0) {
+                    const unsigned int index = 31 - __builtin_clz(mask);
+                    chunk[index] = (next - &chunk[index]) ^ Delimiter;
+                    next = &chunk[index];
+                    mask &= ~(1u << index);
+                }
+            }
+            encode_tail<Delimiter>(buffer, chunk, next);
+        }
+#endif
+
+#if defined(__AVX2__) and not defined(COBS_NO_SIMD)
+        /**
+         * The AVX2 kernel of encode(). Same as encode_block_sse2(), but 32 bytes
+         * at a time.
+         *
+         * @tparam Delimiter The byte, that does not occur in the encoded data
+         * @param buffer The i/o buffer. Index 0 must be 0x00.
+         * @param size The size of the buffer. Must be in the range 1 - 255.
+         */
+        template <uint8_t Delimiter = 0x00>
+        static inline void encode_block_avx2(uint8_t* buffer, const size_t size) {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i delimiter = _mm256_set1_epi8((char)Delimiter);
+            uint8_t* next = buffer + size;  // The position of the next code byte
+            uint8_t* chunk = next;
+            while (chunk - buffer >= 32) {
+                chunk -= 32;
+                const __m256i data = _mm256_loadu_si256((const __m256i*)chunk);
+                unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, zero));
+                if (Delimiter != 0x00)
+                    _mm256_storeu_si256((__m256i*)chunk, _mm256_xor_si256(data, delimiter));
+                // Walk the 0x00 bytes from the back of the chunk
+                while (mask != 0) {
+                    const unsigned int index = 31 - __builtin_clz(mask);
+                    chunk[index] = (next - &chunk[index]) ^ Delimiter;
+                    next = &chunk[index];
+                    mask &= ~(1u << index);
+                }
+            }
+            encode_tail<Delimiter>(buffer, chunk, next);
+        }
+#endif
+
+        /**
+         * Copy data, that is encoded for a delimiter other than 0x00. Such data is
+         * encoded as usual and every byte is XORed with the delimiter, which
+         * replaces all 0x00 bytes of the output with the delimiter and vice versa.
+         * For the default delimiter this is a plain memcpy().
+         */
+        template <uint8_t Delimiter>
+        static inline void copy_xor(uint8_t* destination, const uint8_t* source, const size_t size) {
+            if (Delimiter == 0x00) {
+                // memcpy() must not be called with NULL, even if the size is 0
+                if (size != 0)
+                    memcpy(destination, source, size);
+            } else {
+                for (size_t i = 0; i < size; i++) {
+                    destination[i] = source[i] ^ Delimiter;
+                }
+            }
+        }
+
+        /**
+         * Same as copy_xor(), but the destination may overlap the source, if it
+         * starts in front of it. This is used by the in place encoder and decoder.
+         */
+        template <uint8_t Delimiter>
+        static inline void move_xor(uint8_t* destination, const uint8_t* source, const size_t size) {
+            if (Delimiter == 0x00) {
+                if (destination != source and size != 0)
+                    memmove(destination, source, size);
+            } else {
+                for (size_t i = 0; i < size; i++) {
+                    destination[i] = source[i] ^ Delimiter;
+                }
+            }
+        }
+
+        /**
+         * Same as copy_xor(), but for chunks of 16 bytes, which the compiler
+         * turns into vector loads and stores.
+         */
+        template <uint8_t Delimiter>
+        static inline void copy_xor_16(uint8_t* destination, const uint8_t* source) {
+            if (Delimiter == 0x00) {
+                memcpy(destination, source, 16);
+            } else {
+                for (size_t i = 0; i < 16; i++) {
+                    destination[i] = source[i] ^ Delimiter;
+                }
+            }
+        }
+
+        /**
+         * XOR the data bytes of a group with the delimiter, while the decoder
+         * walks the code bytes, so the block is only traversed once.
+         *
+         * @param code The position of the code byte of the group
+         * @param length The (decoded) code of the group
+         * @param end The end of the block. The last group may extend beyond it.
+         */
+        template <uint8_t Delimiter>
+        static inline void xor_group(uint8_t* code, const size_t length, const uint8_t* end) {
+            uint8_t* endOfGroup = (size_t)(end - code) < length ? const_cast<uint8_t*>(end) : code + length;
+            for (uint8_t* cursor = code + 1; cursor < endOfGroup; cursor++) {
+                *cursor ^= Delimiter;
+            }
+        }
+
+        /**
+         * Select the fastest kernel of encode() supported by the target.
+         */
+        template <uint8_t Delimiter>
+        static inline void encode_block(uint8_t* buffer, const size_t size) {
+#if defined(__AVX2__) and not defined(COBS_NO_SIMD)
+            encode_block_avx2<Delimiter>(buffer, size);
+#elif defined(__SSE2__) and not defined(COBS_NO_SIMD)
+            encode_block_sse2<Delimiter>(buffer, size);
+#elif defined(COBS_SWAR) and COBS_SWAR == 8
+            encode_block_swar<uint64_t, Delimiter>(buffer, size);
+#elif defined(COBS_SWAR)
+            encode_block_swar<uint32_t, Delimiter>(buffer, size);
+#else
+            encode_block_scalar<Delimiter>(buffer, size);
+#endif
+        }
+
+        /**
+         * The kernel of decode().
+         *
+         * @return The block size, which is size - 1, or 0 if the block is invalid
+         */
+        template <uint8_t Delimiter>
+        static inline size_t decode_block(uint8_t* buffer, const size_t size) {
+            uint8_t tmp = 0;
+            uint8_t* endOfBuffer = buffer + size;
+            COBS_STATS_ONLY(size_t groups = 0);
+
+            do {
+                tmp = *buffer ^ Delimiter;  // Store the offset of the first encoded character
+                if (tmp == 0) {
+                    COBS_STATS_ERROR(Status::ZERO_CODE);
+                    return 0;  // 0 offset is invalid
+                }
+                *buffer = 0x00;
+                if (Delimiter != 0x00)
+                    xor_group<Delimiter>(buffer, tmp, endOfBuffer);
+                buffer += tmp;  // If we are out of bounds, this will be the last iteration
+                COBS_STATS_ONLY(groups++);
+            } while(buffer < endOfBuffer);
+
+            COBS_STATS_DECODE(size, size - 1, groups);
+            return size - 1;
+        }
+    }   // Namespace detail
+
     /**
      * Encode an input array of byte with the COBS algorithm.
+     * The fastest kernel supported by the target is selected at compile time. Define
+     * COBS_NO_SIMD to disable the SSE2 and AVX2 kernels. On targets without a vector
+     * unit, e.g. 32 bit microcontrollers, define COBS_SWAR to the word size (4 or 8)
+     * to test a word at a time instead of a byte at a time.
+     *
+     * The byte eliminated from the output, which can then be used as the delimiter,
+     * is 0x00 by default. Pass a different one as template parameter, e.g.
+     * encode<0x7E>(buffer, size). Then all output bytes are XORed with the delimiter.
      *
+     * @tparam Delimiter The byte, that does not occur in the encoded data
      * @param buffer The i/o buffer. The data must start at index 1. Index 0 will be overwritten with the overhead byte
      * @param size of the buffer to be encoded. Must be at least
      * one and not greater than 255 The size of the data block must be at most 254 bytes, because one
      * byte is the overhead byte
      * @return The ecoded size of the data
      */
-    static size_t encode(uint8_t* buffer, const size_t size) __attribute__((unused));
+    template <uint8_t Delimiter = 0x00>
     static size_t encode(uint8_t* buffer, const size_t size) {
+      COBS_STATS_TIMER(encodeNanoseconds);
       // Error out if the message is larger than the maximum block size of
       // the COBS algorithm (254). This code does not handle multiple blocks.
       // Also abort if there is only byte, because there is no data to encode.
-      if (size > 255 or size < 1)
+      if (size > 255 or size < 1) {
+          // An empty buffer has no room for the overhead byte. Like validate(), count it as OUT_OF_RANGE.
+          COBS_STATS_ERROR(size == 0 ? Status::OUT_OF_RANGE : Status::OVERSIZE);
           return 0;
+      }
 
-      uint8_t* endOfBlock = &buffer[size-1];
       // Write a 0 before the data block. This is the COBS overhead byte.
       // This 0x00 byte will be overwritten later, but serves as a terminator for the parser for now.
       buffer[0] = 0x00;
 
-      uint8_t* cursor;
-      do {
-          // Search for a 0x00 byte starting from the back of the stream.
-          // This is the reason why we needed to prepend the 0x00 byte to the
-          // data block. It serves as a terminator and saves us a bounds check while
-          // iterating the loop.
-          for (cursor = endOfBlock; *cursor != 0x00; cursor--) {};
-          // 0x00 0xXX 0xXX 0xXX 0xYY 0xXX 0xXX 0xXX ....
-          //   ^             ^     ^
-          //   |             |     |
-          // cursor   endOfBlock   was 0x00
-          *cursor = endOfBlock - cursor + 1;  // Calculate the number of bytes until the next 0x00 byte
-          // Go to the next block and repeat
-          endOfBlock = cursor - 1;
-      } while (cursor > buffer);
-
-      // If the first data byte was 0x00, then the loop will abort after encoding
-      // this block, so we need to manually check our overhead byte. If it still
-      // says 0x00, then the loop aborted.
-      if (buffer[0] == 0x00) {
-          buffer[0] = 0x01;
-      }
+      detail::encode_block<Delimiter>(buffer, size);
+      COBS_STATS_ENCODE(size - 1, size);
       return size;
     }
 
@@ -91,29 +412,611 @@ namespace cobs {
      * @param *buffer A pointer to the buffer containing the encoded data, without the delimiter/framing byte.
      * After decoding the buffer will contain the data without the overhead byte.
      * The overhead byte is the first byte, so the data stream will have an offset of +1.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
      * @param size The size of the buffer
      *@return The block size, which is size - 1
      */
-    static size_t decode(uint8_t* buffer, const size_t size) __attribute__((unused));
+    template <uint8_t Delimiter = 0x00>
     static size_t decode(uint8_t* buffer, const size_t size) {
+        COBS_STATS_TIMER(decodeNanoseconds);
         // All COBS encoded blocks contain at least the header, even encoded empty
         // packets (size == 1). The maximum size of a message is limited to
         // 254 bytes (unencoded). Therefore the maximum input size is 255 encoded bytes.
+        if (size < 1 or size > 255) {
+            // An empty buffer lacks the overhead byte. Like validate(), count it as OUT_OF_RANGE.
+            COBS_STATS_ERROR(size == 0 ? Status::OUT_OF_RANGE : Status::OVERSIZE);
+            return 0;
+        }
+
+        return detail::decode_block<Delimiter>(buffer, size);
+    }
+
+    /**
+     * Same as encode(), but for blocks of a fixed size. The size is checked at
+     * compile time and the compiler can unroll the encoder for small blocks.
+     * This has its own name, so a delimiter passed to encode() can never be
+     * mistaken for a size.
+     *
+     * @tparam Size The size of the buffer to be encoded including the overhead byte. Must be in the range 1 - 255.
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param buffer The i/o buffer. The data must start at index 1. Index 0 will be overwritten with the overhead byte
+     * @return The encoded size of the data, which is Size
+     */
+    template <size_t Size, uint8_t Delimiter = 0x00>
+    static inline size_t encode_fixed(uint8_t* buffer) {
+        static_assert(Size >= 1 and Size <= 255, "The block size must be in the range 1 - 255");
+        buffer[0] = 0x00;
+        detail::encode_block<Delimiter>(buffer, Size);
+        COBS_STATS_ENCODE(Size - 1, Size);
+        return Size;
+    }
+
+    /**
+     * Same as decode(), but for blocks of a fixed size, which is checked at
+     * compile time.
+     *
+     * @tparam Size The size of the encoded block. Must be in the range 1 - 255.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param buffer A pointer to the buffer containing the encoded data, without the delimiter/framing byte.
+     * @return The block size, which is Size - 1, or 0 if the block is invalid
+     */
+    template <size_t Size, uint8_t Delimiter = 0x00>
+    static inline size_t decode_fixed(uint8_t* buffer) {
+        static_assert(Size >= 1 and Size <= 255, "The block size must be in the range 1 - 255");
+        return detail::decode_block<Delimiter>(buffer, Size);
+    }
+
+    /**
+     * Encode an input array of bytes with the COBS/R (reduced) algorithm. COBS/R
+     * is identical to COBS, except for the last group: if the last data byte is
+     * larger than the code of the last group, it replaces that code byte and the
+     * encoded block is one byte shorter. This removes the overhead byte for most
+     * short frames, that do not end with a small value.
+     * The output must be decoded with decode_reduced().
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param buffer The i/o buffer. The data must start at index 1. Index 0 will be overwritten with the overhead byte
+     * @param size of the buffer to be encoded. Must be at least one and not greater than 255
+     * @return The encoded size of the data, which is either size or size - 1
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_reduced(uint8_t* buffer, const size_t size) {
+        if (size > 255 or size < 1)
+            return 0;
+
+        buffer[0] = 0x00;
+
+        // Find the code byte of the last group, which is the last 0x00
+        uint8_t* last = buffer + size - 1;
+        uint8_t* code = last;
+        while (*code != 0x00)
+            code--;
+        const uint8_t lastByte = *last;
+        const size_t lastCode = last - code + 1;
+
+        detail::encode_block<Delimiter>(buffer, size);
+        size_t encodedSize = size;
+        if (lastByte > lastCode) {
+            *code = lastByte ^ Delimiter;
+            encodedSize--;
+        }
+        return encodedSize;
+    }
+
+    /**
+     * Decodes a COBS/R buffer in place. See encode_reduced().
+     * If the code of the last group points beyond the end of the block, it is
+     * the last data byte, which is then appended to the data. The buffer must
+     * therefore be one byte larger than size.
+     *
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param buffer A pointer to the buffer containing the encoded data, without the delimiter/framing byte.
+     * After decoding the buffer will contain the data with an offset of +1.
+     * @param size The size of the encoded block. The buffer must hold size + 1 bytes.
+     * @return The block size, which is size - 1 or size, or 0 if the block is invalid
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t decode_reduced(uint8_t* buffer, const size_t size) {
         if (size < 1 or size > 255)
             return 0;
 
         uint8_t tmp = 0;
         uint8_t* endOfBuffer = buffer + size;
-
+        uint8_t* cursor = buffer;
         do {
-            tmp = *buffer;  // Store the offset of the first encoded character
+            tmp = *cursor ^ Delimiter;
             if (tmp == 0) return 0;  // 0 offset is invalid
-            *buffer = 0x00;
-            buffer += tmp;  // If we are out of bounds, this will be the last iteration
-        } while(buffer < endOfBuffer);
+            *cursor = 0x00;
+            if (Delimiter != 0x00)
+                detail::xor_group<Delimiter>(cursor, tmp, endOfBuffer);
+            cursor += tmp;
+        } while(cursor < endOfBuffer);
+
+        if (cursor == endOfBuffer)
+            return size - 1;
+
+        // The last code byte was replaced by the last data byte. The data block
+        // is limited to 254 bytes like for encode().
+        if (size > 254)
+            return 0;
+        *endOfBuffer = tmp;
+        return size;
+    }
+
+    /**
+     * Out of place COBS encoder. Unlike the in place functions above, these
+     * are not limited to a single block. Frames of arbitrary length are split
+     * into groups of at most 254 non-zero bytes, using the 0xFF group code for
+     * full groups, which are not followed by an implicit 0x00.
+     */
+
+    /**
+     * Calculate the worst case size of an encoded frame. Use this to size the
+     * output buffer of encode_to().
+     *
+     * @param size The number of (unencoded) data bytes
+     * @return The maximum number of bytes the encoder will produce, excluding the delimiter
+     */
+    static constexpr size_t max_encoded_size(const size_t size) {
+        // One code byte per started group of 254 bytes, but at least one,
+        // even for an empty frame
+        return size == 0 ? 1 : size + (size + 253) / 254;
+    }
+
+    namespace detail {
+        /**
+         * The kernel of encode_to(). It can also encode a part of a frame, that
+         * starts and ends at group boundaries, i.e. after a 0x00 or a full group.
+         *
+         * @param source The data to be encoded
+         * @param size The number of bytes in source
+         * @param destination The output buffer. It must be large enough.
+         * @param endOfFrame If false, the data ends with a closed group. The group,
+         * that would be started after it, belongs to the next part.
+         * @return The encoded size of the data
+         */
+        template <uint8_t Delimiter = 0x00>
+        static inline size_t encode_groups(const uint8_t* source, const size_t size, uint8_t* destination, const bool endOfFrame) {
+            const uint8_t* endOfSource = source + size;
+            uint8_t* code = destination;  // The position of the code byte of the current group
+            uint8_t* cursor = destination + 1;
+            uint8_t groupSize = 1;
+
+            for (; source < endOfSource; source++) {
+                if (*source != 0x00) {
+                    *cursor++ = *source ^ Delimiter;
+                    // Keep filling the group, unless it is full. A full group at
+                    // the end of the frame does not need a new group after it.
+                    if (++groupSize != 0xFF or (endOfFrame and source + 1 == endOfSource))
+                        continue;
+                }
+                // Close the current group and start a new one
+                *code = groupSize ^ Delimiter;
+                code = cursor++;
+                groupSize = 1;
+            }
+            if (not endOfFrame and groupSize == 1)
+                return code - destination;  // Drop the empty group
+            *code = groupSize ^ Delimiter;
+
+            return cursor - destination;
+        }
+
+        /**
+         * Encodes a frame, that is written in pieces, straight into the output
+         * buffer. Unlike encode_groups(), the pieces do not have to end at group
+         * boundaries.
+         */
+        template <uint8_t Delimiter>
+        class GroupWriter {
+          public:
+            explicit GroupWriter(uint8_t* destination) : destination(destination), code(destination), cursor(destination + 1), groupSize(1) {}
+
+            void write(const uint8_t* data, const size_t size) {
+                const uint8_t* endOfData = data + size;
+
+                while (data < endOfData) {
+                    // A full group is only closed, when more data follows. A
+                    // full group at the end of the frame does not need a new
+                    // group after it.
+                    if (groupSize == 0xFF)
+                        close();
+                    size_t chunkSize = endOfData - data;
+                    if (chunkSize > (size_t)(0xFF - groupSize))
+                        chunkSize = 0xFF - groupSize;
+                    const uint8_t* zero = static_cast<const uint8_t*>(memchr(data, 0x00, chunkSize));
+                    if (zero != NULL)
+                        chunkSize = zero - data;
+                    copy_xor<Delimiter>(cursor, data, chunkSize);
+                    cursor += chunkSize;
+                    groupSize += chunkSize;
+                    data += chunkSize;
+                    if (zero != NULL) {
+                        data++;  // The 0x00 is replaced by the code byte
+                        close();
+                    }
+                }
+            }
+
+            /**
+             * Append a single byte. This is meant for loops, that do more work per
+             * byte, e.g. calculate a checksum, so the data is only read once.
+             */
+            void put(const uint8_t byte) {
+                if (groupSize == 0xFF)
+                    close();
+                if (byte == 0x00) {
+                    close();  // The 0x00 is replaced by the code byte
+                } else {
+                    *cursor++ = byte ^ Delimiter;
+                    groupSize++;
+                }
+            }
+
+            /**
+             * Close the last group.
+             *
+             * @return The encoded size of the frame
+             */
+            size_t finish() {
+                *code = groupSize ^ Delimiter;
+                return cursor - destination;
+            }
+
+          private:
+            void close() {
+                *code = groupSize ^ Delimiter;
+                code = cursor++;
+                groupSize = 1;
+            }
+
+            uint8_t* destination;
+            uint8_t* code;  // The position of the code byte of the current group
+            uint8_t* cursor;
+            size_t groupSize;
+        };
+    }   // Namespace detail
+
+    /**
+     * Encode an input array of bytes of arbitrary length with the COBS algorithm.
+     *
+     * @param source The data to be encoded. It will not be modified.
+     * @param size The number of bytes in source
+     * @param destination The output buffer. It must not overlap the source.
+     * @param capacity The size of the output buffer. Must be at least max_encoded_size(size)
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @return The encoded size of the data or 0 if the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_to(const uint8_t* source, const size_t size, uint8_t* destination, const size_t capacity) {
+        COBS_STATS_TIMER(encodeNanoseconds);
+        if (capacity < max_encoded_size(size)) {
+            COBS_STATS_ERROR(Status::OVERSIZE);
+            return 0;
+        }
+
+        const size_t encodedSize = detail::encode_groups<Delimiter>(source, size, destination, true);
+        COBS_STATS_ENCODE(size, encodedSize);
+        return encodedSize;
+    }
+
+    /**
+     * Decode a COBS encoded frame of arbitrary length into a separate buffer.
+     * Each group is copied as a whole. Every code byte is checked against both
+     * the input and the output buffer first, so a corrupted frame can never
+     * cause reads or writes out of bounds.
+     *
+     * @param source The encoded data, without the delimiter/framing byte. It will not be modified.
+     * @param size The size of the encoded data
+     * @param destination The output buffer. It must not overlap the source.
+     * @param capacity The size of the output buffer. size - 1 bytes are always sufficient.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @return The decoded size of the data or 0 if the frame is invalid or the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t decode_to(const uint8_t* source, const size_t size, uint8_t* destination, const size_t capacity) {
+        COBS_STATS_TIMER(decodeNanoseconds);
+        const uint8_t* endOfSource = source + size;
+        uint8_t* cursor = destination;
+        uint8_t* endOfDestination = destination + capacity;
+        COBS_STATS_ONLY(size_t groups = 0);
+
+        while (source < endOfSource) {
+            const uint8_t code = *source++ ^ Delimiter;
+            if (code == 0) {
+                COBS_STATS_ERROR(Status::ZERO_CODE);
+                return 0;  // 0 offset is invalid
+            }
+            // The group must not extend beyond the encoded data and it must
+            // fit into the output buffer
+            if ((size_t)(code - 1) > (size_t)(endOfSource - source)) {
+                COBS_STATS_ERROR(Status::OUT_OF_RANGE);
+                return 0;
+            }
+            if ((size_t)(code - 1) > (size_t)(endOfDestination - cursor)) {
+                COBS_STATS_ERROR(Status::OVERSIZE);
+                return 0;
+            }
+
+            // Copy the whole group at once. As long as both buffers have enough
+            // room left for the largest group, copy it in fixed size chunks. The
+            // compiler turns these into vector loads and stores, which is a lot
+            // faster than calling memcpy() for every (short) group. Bytes copied
+            // past the end of the group are overwritten by the next one.
+            const size_t length = code - 1;
+            if ((size_t)(endOfSource - source) >= 256 and (size_t)(endOfDestination - cursor) >= 256) {
+                for (size_t i = 0; i < length; i += 16) {
+                    detail::copy_xor_16<Delimiter>(cursor + i, source + i);
+                }
+            } else {
+                detail::copy_xor<Delimiter>(cursor, source, length);
+            }
+            cursor += length;
+            source += length;
+            COBS_STATS_ONLY(groups++);
+            // Every group, except a full one or the last one, ends with an implicit 0x00
+            if (code != 0xFF and source < endOfSource) {
+                if (cursor == endOfDestination) {
+                    COBS_STATS_ERROR(Status::OVERSIZE);
+                    return 0;
+                }
+                *cursor++ = 0x00;
+            }
+        }
+
+        COBS_STATS_DECODE(size, cursor - destination, groups);
+        return cursor - destination;
+    }
+
+    /**
+     * Check a COBS encoded frame of arbitrary length without decoding it. The
+     * code chain is walked and the frame is searched for the delimiter, but
+     * nothing is written, so valid frames can be forwarded as they are.
+     * The search uses memchr(), which is vectorized by most C libraries.
+     *
+     * @param buffer The encoded data, without the delimiter/framing byte. It will not be modified.
+     * @param size The size of the encoded data
+     * @param status If not NULL, the cause of an error is written here
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @return The decoded size of the data or 0 if the frame is invalid
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t validate(const uint8_t* buffer, const size_t size, Status* status = NULL) {
+        const uint8_t* source = buffer;
+        const uint8_t* endOfBuffer = buffer + size;
+        size_t length = 0;
+        // Every frame has at least one code byte, like for the decoders
+        Status result = size == 0 ? Status::OUT_OF_RANGE : Status::OK;
+
+        while (result == Status::OK and source < endOfBuffer) {
+            const uint8_t code = *source++ ^ Delimiter;
+            if (code == 0) {
+                result = Status::ZERO_CODE;
+                break;
+            }
+            if ((size_t)(code - 1) > (size_t)(endOfBuffer - source)) {
+                result = Status::OUT_OF_RANGE;
+                break;
+            }
+            source += code - 1;
+            length += code - 1;
+            // Every group, except a full one or the last one, ends with an implicit 0x00
+            if (code != 0xFF and source < endOfBuffer)
+                length++;
+        }
+        // The code bytes are checked above, the data bytes must not contain the delimiter either
+        if (result == Status::OK and memchr(buffer, Delimiter, size) != NULL)
+            result = Status::DELIMITER;
+
+        if (status != NULL)
+            *status = result;
+        return result == Status::OK ? length : 0;
+    }
+
+    /**
+     * Calculate the number of bytes that must be reserved in front of the data
+     * when encoding a frame with encode_in_place().
+     *
+     * @param size The number of (unencoded) data bytes
+     * @return The required headroom, which is one byte per started block of 254 bytes
+     */
+    static constexpr size_t headroom(const size_t size) {
+        return max_encoded_size(size) - size;
+    }
+
+    /**
+     * In place COBS encoder for frames of arbitrary length. Zeros are replaced
+     * by their group codes in place. Only the code bytes of full (0xFF) groups
+     * need additional space, which is taken from the headroom, so the data is
+     * processed in a single forward pass, one group at a time, and shifted
+     * towards the front of the buffer by the headroom not yet used up. With a
+     * headroom of 1 byte and no full groups, no data is moved at all.
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param buffer The i/o buffer. The data must start at index headroom. The encoded data will start at index 0.
+     * @param size The number of data bytes
+     * @param headroom The number of bytes reserved in front of the data. Must be at least headroom(size).
+     * @return The encoded size of the data or 0 if the headroom is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_in_place(uint8_t* buffer, const size_t size, const size_t headroom) {
+        COBS_STATS_TIMER(encodeNanoseconds);
+        if (headroom < cobs::headroom(size)) {
+            COBS_STATS_ERROR(Status::OVERSIZE);
+            return 0;
+        }
+
+        const uint8_t* source = buffer + headroom;
+        const uint8_t* endOfData = source + size;
+        uint8_t* code = buffer;  // The position of the code byte of the current group
+        uint8_t* cursor = buffer + 1;
+
+        // The cursor never overtakes the source, because every code byte, that
+        // does not replace a 0x00, was reserved as headroom.
+        for (;;) {
+            size_t length = endOfData - source;
+            if (length > 254)
+                length = 254;
+            const uint8_t* zero = (const uint8_t*)memchr(source, 0x00, length);
+            if (zero != NULL)
+                length = zero - source;
+
+            detail::move_xor<Delimiter>(cursor, source, length);
+            cursor += length;
+            source += length;
+            *code = (length + 1) ^ Delimiter;  // This is 0xFF for a full group
+
+            // The frame ends with a group, that is neither terminated by a
+            // 0x00, nor followed by more data
+            if (zero == NULL and (length != 254 or source == endOfData))
+                break;
+            // Start a new group
+            code = cursor++;
+            if (zero != NULL)
+                source++;
+        }
+
+        COBS_STATS_ENCODE(size, cursor - buffer);
+        return cursor - buffer;
+    }
+
+    namespace detail {
+        /**
+         * The kernel of decode_in_place(). Reports the cause of an error.
+         */
+        template <uint8_t Delimiter = 0x00>
+        static inline size_t decode_in_place(uint8_t* buffer, const size_t size, Status& status) {
+            const uint8_t* source = buffer;
+            const uint8_t* endOfBuffer = buffer + size;
+            uint8_t* cursor = buffer;
+            COBS_STATS_ONLY(size_t groups = 0);
+
+            // The cursor always trails the source by at least one byte, because
+            // every group starts with a code byte, that is removed.
+            while (source < endOfBuffer) {
+                const uint8_t code = *source++ ^ Delimiter;
+                if (code == 0) {
+                    COBS_STATS_ERROR(Status::ZERO_CODE);
+                    status = Status::ZERO_CODE;
+                    return 0;
+                }
+                if ((size_t)(code - 1) > (size_t)(endOfBuffer - source)) {
+                    COBS_STATS_ERROR(Status::OUT_OF_RANGE);
+                    status = Status::OUT_OF_RANGE;
+                    return 0;
+                }
+                detail::move_xor<Delimiter>(cursor, source, code - 1);
+                cursor += code - 1;
+                source += code - 1;
+                COBS_STATS_ONLY(groups++);
+                // Every group, except a full one or the last one, ends with an implicit 0x00
+                if (code != 0xFF and source < endOfBuffer)
+                    *cursor++ = 0x00;
+            }
+
+            COBS_STATS_DECODE(size, cursor - buffer, groups);
+            status = Status::OK;
+            return cursor - buffer;
+        }
+    }   // Namespace detail
+
+    /**
+     * In place COBS decoder for frames of arbitrary length. This is the
+     * counterpart of encode_in_place(). Unlike decode(), the data is moved to the
+     * front of the buffer, because full (0xFF) groups are not followed by a 0x00,
+     * that could take the place of the next code byte.
+     *
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param buffer The i/o buffer containing the encoded data, without the delimiter/framing byte.
+     * The decoded data will start at index 0.
+     * @param size The size of the encoded data
+     * @return The decoded size of the data or 0 if the frame is invalid
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t decode_in_place(uint8_t* buffer, const size_t size) {
+        COBS_STATS_TIMER(decodeNanoseconds);
+        Status status;
+        return detail::decode_in_place<Delimiter>(buffer, size, status);
+    }
+
+    /**
+     * Decode a frame straight into an object, e.g. a struct, instead of a byte
+     * buffer. The object is properly aligned, so no copy is needed to access its
+     * members. To decode into an aligned buffer instead, use decode_to() or
+     * decode_in_place(), which both place the data at the start of the output.
+     *
+     * @tparam T A trivially copyable type of at most 254 bytes, so the frame is a single block
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param source The encoded data, without the delimiter/framing byte. It will not be modified.
+     * @param size The size of the encoded data
+     * @param value The decoded object. It is undefined, if the frame is invalid.
+     * @return True if the frame is valid and its decoded size is sizeof(T)
+     */
+    template <typename T, uint8_t Delimiter = 0x00>
+    static bool decode_as(const uint8_t* source, const size_t size, T& value) {
+        static_assert(__is_trivially_copyable(T), "The type must be trivially copyable");
+        static_assert(sizeof(T) <= 254, "The type must not be larger than a single block of 254 bytes");
+        // A frame, that decodes to more than sizeof(T) bytes, is rejected by decode_to()
+        return decode_to<Delimiter>(source, size, reinterpret_cast<uint8_t*>(&value), sizeof(T)) == sizeof(T);
+    }
+
+    /**
+     * The worst case encoded size of a frame with a size known at compile time.
+     *
+     * @tparam Size The number of (unencoded) data bytes
+     * @return The maximum number of bytes the encoder will produce, excluding the delimiter
+     */
+    template <size_t Size>
+    static constexpr size_t max_encoded_size() {
+        return max_encoded_size(Size);
+    }
+
+#if __cplusplus >= 201402L
+    /**
+     * An encoded frame of a fixed capacity. It is returned by encode_frame().
+     */
+    template <size_t Capacity>
+    struct Frame {
+        uint8_t data[Capacity];
+        size_t size;  // The encoded size, excluding the delimiter
+    };
+
+    /**
+     * Encode a frame at compile time. Use this for constant frames, like
+     * commands, so that they can be stored in flash already encoded. This
+     * requires C++14.
+     *
+     *   static constexpr uint8_t ping[] = {0x01, 0x00};
+     *   static constexpr auto encodedPing = cobs::encode_frame(ping);
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param payload The data to be encoded
+     * @return The encoded frame. The output is the same as for encode_to().
+     */
+    template <uint8_t Delimiter = 0x00, size_t Size>
+    static constexpr Frame<max_encoded_size(Size)> encode_frame(const uint8_t (&payload)[Size]) {
+        Frame<max_encoded_size(Size)> frame = {};
+        size_t code = 0;  // The position of the code byte of the current group
+        size_t cursor = 1;
+        uint8_t groupSize = 1;
+
+        for (size_t i = 0; i < Size; i++) {
+            if (payload[i] != 0x00) {
+                frame.data[cursor++] = payload[i] ^ Delimiter;
+                // A full group at the end of the frame does not need a new group after it
+                if (++groupSize != 0xFF or i + 1 == Size)
+                    continue;
+            }
+            frame.data[code] = groupSize ^ Delimiter;
+            code = cursor++;
+            groupSize = 1;
+        }
+        frame.data[code] = groupSize ^ Delimiter;
+        frame.size = cursor;
 
-        return size - 1;
+        return frame;
     }
+#endif
 }   // Namespace cobs
 #endif  // COBS_CPP_H
 
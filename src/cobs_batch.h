@@ -0,0 +1,85 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_BATCH_CPP_H
+#define COBS_BATCH_CPP_H
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr
+
+#include "cobs.h"
+
+namespace cobs {
+    /**
+     * An entry of the frame table produced by decode_frames().
+     */
+    struct FrameInfo {
+        size_t offset;  // The start of the decoded frame within the buffer
+        size_t length;  // The decoded size of the frame
+        Status status;  // Invalid frames are reported, but their data is undefined
+    };
+
+    /**
+     * Split a buffer containing many delimited frames and decode all of them
+     * in place. The delimiters are located using memchr(), which is vectorized by
+     * the C library on most hosts. Each frame is decoded to the start of its
+     * encoded data, so the caller can iterate the frames within the buffer without
+     * copying them. Invalid frames are flagged in the table and do not abort the
+     * batch. Empty frames, i.e. consecutive delimiters, are skipped.
+     *
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param buffer The i/o buffer containing the encoded frames
+     * @param size The size of the buffer
+     * @param frames The frame table
+     * @param maxFrames The number of entries in the frame table
+     * @param consumed Optional. Returns the number of bytes processed. Any bytes after
+     * the last delimiter belong to an incomplete frame and are not touched. The same
+     * applies to all frames, that did not fit into the table.
+     * @return The number of entries written to the frame table
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t decode_frames(uint8_t* buffer, const size_t size, FrameInfo* frames, const size_t maxFrames, size_t* consumed = NULL) {
+        uint8_t* startOfFrame = buffer;
+        uint8_t* endOfBuffer = buffer + size;
+        size_t frameCount = 0;
+
+        while (frameCount < maxFrames and startOfFrame < endOfBuffer) {
+            uint8_t* delimiter = static_cast<uint8_t*>(memchr(startOfFrame, Delimiter, endOfBuffer - startOfFrame));
+            if (delimiter == NULL)
+                break;
+
+            if (delimiter != startOfFrame) {
+                FrameInfo& frame = frames[frameCount++];
+                frame.offset = startOfFrame - buffer;
+                frame.length = detail::decode_in_place<Delimiter>(startOfFrame, delimiter - startOfFrame, frame.status);
+            }
+            startOfFrame = delimiter + 1;
+        }
+
+        if (consumed != NULL)
+            *consumed = startOfFrame - buffer;
+        return frameCount;
+    }
+}   // Namespace cobs
+#endif  // COBS_BATCH_CPP_H
@@ -0,0 +1,115 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_CONCURRENT_POOL_CPP_H
+#define COBS_CONCURRENT_POOL_CPP_H
+
+/**
+ * A pool of frame slots, that can be shared by several threads. This requires
+ * std::atomic and is meant for hosts.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+
+#include <atomic>
+
+#include "cobs.h"
+#include "cobs_pool.h"
+
+namespace cobs {
+    /**
+     * The thread safe counterpart of FramePool. The free slots are kept on a
+     * lock-free stack. The top of the stack is stored together with a tag,
+     * which is incremented on every change, in a single 64 bit word, so a
+     * compare and swap cannot succeed on a stale top (ABA problem). Slots may be
+     * acquired and released by any thread, e.g. acquired by the receiving thread
+     * and released by the worker, that processed the frame.
+     *
+     * @tparam SlotCount The number of slots
+     * @tparam SlotSize The size of each slot. The default fits the largest single block frame, either encoded or decoded.
+     */
+    template <size_t SlotCount, size_t SlotSize = max_encoded_size(254)>
+    class ConcurrentFramePool {
+        static_assert(SlotCount > 0 and SlotCount < 0xFFFFFFFF, "The slot count must fit into 32 bit");
+
+      public:
+        static const size_t SLOT_COUNT = SlotCount;
+        static const size_t SLOT_SIZE = SlotSize;
+
+        ConcurrentFramePool() : top(0) {
+            for (size_t i = 0; i < SlotCount; i++) {
+                next[i].store(i + 1 < SlotCount ? i + 1 : EMPTY, std::memory_order_relaxed);
+            }
+        }
+        ConcurrentFramePool(const ConcurrentFramePool&) = delete;
+        ConcurrentFramePool& operator=(const ConcurrentFramePool&) = delete;
+
+        /**
+         * @return A slot of SLOT_SIZE bytes or NULL if all slots are in use
+         */
+        uint8_t* acquire() {
+            uint64_t current = top.load(std::memory_order_acquire);
+            for (;;) {
+                const uint32_t index = current;
+                if (index == EMPTY)
+                    return NULL;
+                // The next index may be stale, if another thread took the slot
+                // in the meantime, but then the tag has changed and the swap fails
+                const uint64_t replacement = pack(next[index].load(std::memory_order_relaxed), current);
+                if (top.compare_exchange_weak(current, replacement, std::memory_order_acquire, std::memory_order_acquire))
+                    return slots[index];
+            }
+        }
+
+        /**
+         * Return a slot to the pool. The slot must have been acquired from this
+         * pool. The data written to the slot is visible to the thread, that
+         * acquires it next.
+         */
+        void release(uint8_t* slot) {
+            const uint32_t index = (slot - slots[0]) / SlotSize;
+            uint64_t current = top.load(std::memory_order_relaxed);
+            uint64_t replacement;
+            do {
+                next[index].store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+                replacement = pack(index, current);
+            } while (not top.compare_exchange_weak(current, replacement, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+      private:
+        static const uint32_t EMPTY = 0xFFFFFFFF;
+
+        /**
+         * @return The new top of the stack with the tag of the current top incremented
+         */
+        static uint64_t pack(const uint32_t index, const uint64_t current) {
+            return (((current >> 32) + 1) << 32) | index;
+        }
+
+        uint8_t slots[SlotCount][SlotSize];
+        std::atomic<uint32_t> next[SlotCount];  // The next free slot of each free slot
+        alignas(64) std::atomic<uint64_t> top;  // The index of the first free slot and the tag
+    };
+}   // Namespace cobs
+#endif  // COBS_CONCURRENT_POOL_CPP_H
@@ -0,0 +1,277 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_COROUTINE_CPP_H
+#define COBS_COROUTINE_CPP_H
+
+/**
+ * Reading and writing frames from C++20 coroutines. The functions are only
+ * available, if the compiler supports coroutines, e.g. with -std=c++20.
+ *
+ * The library does not depend on a particular I/O framework. A source is any
+ * object with a method read(uint8_t* buffer, size_t capacity), that returns an
+ * awaitable, which resumes with the number of bytes read as size_t or 0 at the
+ * end of the stream. A sink is any object with the methods
+ *   size_t writable()  The number of bytes, that can be written without waiting
+ *   void write(const uint8_t* data, size_t length)  Append data, that fits into writable()
+ *   void wait(size_t size, std::coroutine_handle<> continuation)  Resume the continuation once
+ *     at least size bytes are writable or the sink is closed
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr, memmove
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>  // std::terminate
+
+#include "cobs.h"
+#include "cobs_stream.h"
+
+namespace cobs {
+    /**
+     * A decoded frame. The data points into the receive buffer of the generator.
+     */
+    struct FrameView {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    /**
+     * The asynchronous generator returned by async_frames(). It is created
+     * suspended and runs, when the consumer awaits next(). While the generator
+     * waits for the source, the consumer stays suspended as well. The
+     * coroutine frame of the generator, which includes the receive buffer, is
+     * allocated once, no memory is allocated per frame.
+     */
+    class AsyncFrames {
+      public:
+        struct promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        /**
+         * Returns control to the consumer, when the generator yields a frame or finishes.
+         */
+        struct ResumeConsumer {
+            bool await_ready() const noexcept {
+                return false;
+            }
+            std::coroutine_handle<> await_suspend(Handle generator) noexcept {
+                return generator.promise().consumer;
+            }
+            void await_resume() const noexcept {}
+        };
+
+        struct promise_type {
+            AsyncFrames get_return_object() noexcept {
+                return AsyncFrames(Handle::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+            ResumeConsumer final_suspend() const noexcept {
+                return {};
+            }
+            ResumeConsumer yield_value(const FrameView frame) noexcept {
+                current = frame;
+                return {};
+            }
+            void return_void() const noexcept {}
+            // The library does not use exceptions, the source must not throw either
+            void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+
+            FrameView current;
+            std::coroutine_handle<> consumer;  // The coroutine awaiting next()
+        };
+
+        /**
+         * The awaitable returned by next()
+         */
+        struct NextFrame {
+            bool await_ready() const noexcept {
+                return generator.done();
+            }
+            std::coroutine_handle<> await_suspend(const std::coroutine_handle<> consumer) noexcept {
+                generator.promise().consumer = consumer;
+                return generator;
+            }
+            const FrameView* await_resume() const noexcept {
+                return generator.done() ? NULL : &generator.promise().current;
+            }
+
+            Handle generator;
+        };
+
+        AsyncFrames(AsyncFrames&& other) noexcept : generator(other.generator) {
+            other.generator = NULL;
+        }
+        AsyncFrames(const AsyncFrames&) = delete;
+        AsyncFrames& operator=(const AsyncFrames&) = delete;
+        /**
+         * Do not destroy the generator, while the consumer awaits next().
+         */
+        ~AsyncFrames() {
+            if (generator)
+                generator.destroy();
+        }
+
+        /**
+         * Wait for the next frame.
+         *
+         * @return An awaitable, that resumes with a pointer to the next frame or NULL at the end of the stream.
+         * The frame is only valid until next() is called again.
+         */
+        NextFrame next() const noexcept {
+            return NextFrame{generator};
+        }
+
+      private:
+        explicit AsyncFrames(const Handle generator) : generator(generator) {}
+
+        Handle generator;
+    };
+
+    /**
+     * Read the encoded stream from an asynchronous source and yield the decoded
+     * frames. The frames are decoded in place within the receive buffer and
+     * are not copied. Only the incomplete frame at the end of the buffer is
+     * moved to the front, before more data is read. Empty and invalid frames
+     * are skipped, as are frames, which do not fit into the buffer.
+     *
+     * @code
+     *   cobs::AsyncFrames frames = cobs::async_frames(connection);
+     *   while (const cobs::FrameView* frame = co_await frames.next()) {
+     *     // Process frame->data and frame->size
+     *   }
+     * @endcode
+     *
+     * @tparam Capacity The size of the receive buffer. An encoded frame including its delimiter must fit.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param source The source of the encoded stream. See above. It must outlive the generator.
+     * @return The generator
+     */
+    template <size_t Capacity = max_encoded_size(254) + 1, uint8_t Delimiter = 0x00, typename Source>
+    AsyncFrames async_frames(Source& source) {
+        static_assert(Capacity > 1, "The receive buffer must hold at least an empty frame");
+        uint8_t buffer[Capacity];
+        size_t start = 0;  // The start of the next frame
+        size_t end = 0;  // The end of the data read so far
+        bool discarding = false;  // Skip the rest of a frame, that did not fit
+
+        for (;;) {
+            // Yield all complete frames in the buffer
+            while (start < end) {
+                uint8_t* frame = &buffer[start];
+                const uint8_t* delimiter = static_cast<const uint8_t*>(memchr(frame, Delimiter, end - start));
+                if (delimiter == NULL)
+                    break;
+                const size_t size = delimiter - frame;
+                start += size + 1;
+                if (discarding) {
+                    discarding = false;
+                    continue;
+                }
+                if (size == 0)
+                    continue;
+
+                Status status;
+                const size_t length = detail::decode_in_place<Delimiter>(frame, size, status);
+                if (status == Status::OK)
+                    co_yield FrameView{frame, length};
+            }
+
+            // Make room for more data
+            if (start == end) {
+                start = end = 0;
+            } else if (start > 0) {
+                memmove(buffer, &buffer[start], end - start);
+                end -= start;
+                start = 0;
+            }
+            if (end == Capacity) {
+                // The frame is too large for the buffer
+                discarding = true;
+                end = 0;
+            }
+
+            const size_t size = co_await source.read(&buffer[end], Capacity - end);
+            if (size == 0)
+                co_return;
+            end += size;
+        }
+    }
+
+    /**
+     * The awaitable returned by async_send()
+     */
+    template <uint8_t Delimiter, typename Sink>
+    class SendFrame {
+      public:
+        SendFrame(Sink& sink, const uint8_t* data, const size_t size) : sink(sink), data(data), size(size) {}
+
+        bool await_ready() const {
+            return sink.writable() >= required();
+        }
+        void await_suspend(const std::coroutine_handle<> continuation) {
+            sink.wait(required(), continuation);
+        }
+        size_t await_resume() {
+            if (sink.writable() < required())
+                return 0;  // The sink was closed
+            return encode_to_sink<Delimiter>(data, size, [this](const uint8_t* chunk, size_t length) {
+                sink.write(chunk, length);
+            });
+        }
+
+      private:
+        size_t required() const {
+            return max_encoded_size(size) + 1;  // Including the delimiter
+        }
+
+        Sink& sink;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    /**
+     * Encode a frame directly into an asynchronous sink. If the sink does not
+     * have room for the largest possible encoding, the awaiting coroutine is
+     * suspended until it has. No memory is allocated.
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param sink The sink. See above.
+     * @param data The payload. It must stay valid until the awaitable resumes.
+     * @param size The size of the payload
+     * @return An awaitable, that resumes with the number of bytes written including the delimiter,
+     * or 0 if the sink was closed
+     */
+    template <uint8_t Delimiter = 0x00, typename Sink>
+    SendFrame<Delimiter, Sink> async_send(Sink& sink, const uint8_t* data, const size_t size) {
+        return SendFrame<Delimiter, Sink>(sink, data, size);
+    }
+}   // Namespace cobs
+#endif  // __cpp_impl_coroutine
+#endif  // COBS_COROUTINE_CPP_H
@@ -0,0 +1,164 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+
+Scatter-gather encoding of frames, that are made up of several fragments, e.g.
+a header, a payload and a trailer, without concatenating them first.
+*/
+#ifndef COBS_GATHER_CPP_H
+#define COBS_GATHER_CPP_H
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr
+
+#if defined(__unix__) or defined(__APPLE__)
+#include <sys/uio.h>  // iovec
+#endif
+
+#include "cobs.h"
+
+namespace cobs {
+    /**
+     * A part of a frame. The fragments of a frame are encoded as one payload.
+     */
+    struct Fragment {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    /**
+     * @return The total size of the fragments
+     */
+    static size_t fragments_size(const Fragment* fragments, const size_t count) __attribute__((unused));
+    static size_t fragments_size(const Fragment* fragments, const size_t count) {
+        size_t size = 0;
+        for (size_t i = 0; i < count; i++) {
+            size += fragments[i].size;
+        }
+        return size;
+    }
+
+    /**
+     * Encode a frame, that consists of several fragments, into a single buffer.
+     * The output is the same as encoding the concatenated fragments with
+     * encode_to(). Groups span fragment boundaries.
+     *
+     * @param fragments The parts of the frame. They will not be modified.
+     * @param count The number of fragments
+     * @param destination The output buffer. It must not overlap the fragments.
+     * @param capacity The size of the output buffer. Must be at least
+     * max_encoded_size(fragments_size(fragments, count))
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @return The encoded size of the data or 0 if the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_fragments_to(const Fragment* fragments, const size_t count, uint8_t* destination, const size_t capacity) {
+        if (capacity < max_encoded_size(fragments_size(fragments, count)))
+            return 0;
+
+        detail::GroupWriter<Delimiter> writer(destination);
+        for (size_t i = 0; i < count; i++) {
+            writer.write(fragments[i].data, fragments[i].size);
+        }
+        return writer.finish();
+    }
+
+#if defined(__unix__) or defined(__APPLE__)
+    /**
+     * Encode a frame, that consists of several fragments, into a list of
+     * buffers for writev(). The data is not copied. The iovec list points into
+     * the fragments and to the code bytes, which are stored in a separate
+     * buffer. Every group needs one iovec for the code byte and one per
+     * fragment it spans, so this is best suited for data with few zeros.
+     * The delimiter is not part of the output. Only the delimiter 0x00 is
+     * supported, because the data is passed on unchanged.
+     *
+     * @param fragments The parts of the frame. They must stay valid until the data is written.
+     * @param count The number of fragments
+     * @param codes The buffer for the code bytes. One byte per group is required.
+     * @param codeCapacity The size of the code buffer
+     * @param vectors The output list
+     * @param vectorCapacity The number of entries in the output list
+     * @return The number of entries used or 0 if one of the buffers is too small
+     */
+    static size_t encode_fragments_iov(const Fragment* fragments, const size_t count, uint8_t* codes, const size_t codeCapacity,
+                                       struct iovec* vectors, const size_t vectorCapacity) __attribute__((unused));
+    static size_t encode_fragments_iov(const Fragment* fragments, const size_t count, uint8_t* codes, const size_t codeCapacity,
+                                       struct iovec* vectors, const size_t vectorCapacity) {
+        if (codeCapacity < 1 or vectorCapacity < 1)
+            return 0;
+
+        uint8_t* code = codes;  // The code byte of the current group
+        struct iovec* vector = vectors;
+        const struct iovec* endOfVectors = vectors + vectorCapacity;
+        uint8_t groupSize = 1;
+        vector->iov_base = code;
+        vector->iov_len = 1;
+        vector++;
+
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t* data = fragments[i].data;
+            const uint8_t* endOfData = data + fragments[i].size;
+
+            while (data < endOfData) {
+                // A full group is only closed, when more data follows
+                const bool full = groupSize == 0xFF;
+                size_t chunkSize = endOfData - data;
+                if (not full) {
+                    if (chunkSize > (size_t)(0xFF - groupSize))
+                        chunkSize = 0xFF - groupSize;
+                    const uint8_t* zero = static_cast<const uint8_t*>(memchr(data, 0x00, chunkSize));
+                    if (zero != NULL)
+                        chunkSize = zero - data;
+                    if (chunkSize > 0) {
+                        if (vector == endOfVectors)
+                            return 0;
+                        vector->iov_base = const_cast<uint8_t*>(data);
+                        vector->iov_len = chunkSize;
+                        vector++;
+                        groupSize += chunkSize;
+                        data += chunkSize;
+                    }
+                    if (zero == NULL)
+                        continue;
+                    data++;  // The 0x00 is replaced by the code byte
+                }
+
+                // Close the current group and start a new one
+                *code = groupSize;
+                if (code + 1 == codes + codeCapacity or vector == endOfVectors)
+                    return 0;
+                code++;
+                vector->iov_base = code;
+                vector->iov_len = 1;
+                vector++;
+                groupSize = 1;
+            }
+        }
+        *code = groupSize;
+
+        return vector - vectors;
+    }
+#endif
+}   // Namespace cobs
+#endif  // COBS_GATHER_CPP_H
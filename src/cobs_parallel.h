@@ -0,0 +1,343 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_PARALLEL_CPP_H
+#define COBS_PARALLEL_CPP_H
+
+/**
+ * Multi-threaded encoding and decoding of large frames and captures. This
+ * requires a POSIX host with std::thread support and is not meant for
+ * microcontrollers.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr
+#include <fcntl.h>  // open
+#include <sys/mman.h>  // mmap, posix_madvise, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>  // close
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "cobs.h"
+#include "cobs_batch.h"
+
+namespace cobs {
+    /**
+     * A private, writable memory mapping of a file. Changes, like in place
+     * decoding, are not written back to the file.
+     */
+    class MappedFile {
+      public:
+        MappedFile() : buffer(NULL), length(0) {}
+        ~MappedFile() {
+            close();
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * Map a file into memory.
+         *
+         * @param path The path of the file
+         * @return False if the file could not be opened or mapped
+         */
+        bool open(const char* path) {
+            close();
+            const int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat status;
+            if (fstat(fd, &status) != 0) {
+                ::close(fd);
+                return false;
+            }
+            length = status.st_size;
+            if (length != 0) {
+                void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (mapping == MAP_FAILED) {
+                    ::close(fd);
+                    length = 0;
+                    return false;
+                }
+                posix_madvise(mapping, length, POSIX_MADV_SEQUENTIAL);
+                buffer = static_cast<uint8_t*>(mapping);
+            }
+            ::close(fd);  // The mapping stays valid
+            return true;
+        }
+
+        void close() {
+            if (buffer != NULL)
+                munmap(buffer, length);
+            buffer = NULL;
+            length = 0;
+        }
+
+        uint8_t* data() const {
+            return buffer;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+      private:
+        uint8_t* buffer;
+        size_t length;
+    };
+
+    namespace detail {
+        /**
+         * Call function(chunk) for every chunk in [0, chunkCount) using the calling
+         * thread and threadCount - 1 additional threads. The threads pull the
+         * chunks from a shared counter, so that they can balance the load.
+         */
+        template <typename Function>
+        static void parallel_for(const size_t chunkCount, unsigned int threadCount, Function function) {
+            if (threadCount > chunkCount)
+                threadCount = chunkCount;
+
+            std::atomic<size_t> nextChunk(0);
+            auto worker = [&]() {
+                for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+                    function(chunk);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned int i = 1; i < threadCount; i++) {
+                threads.emplace_back(worker);
+            }
+            worker();
+            for (size_t i = 0; i < threads.size(); i++) {
+                threads[i].join();
+            }
+        }
+
+        /**
+         * Select the number of threads and chunks for a buffer. Chunks smaller than
+         * 64 KiB are not worth the overhead of a thread.
+         *
+         * @param size The size of the buffer
+         * @param threadCount The requested number of threads. 0 selects the number of CPU cores.
+         * @return The number of chunks. There are more chunks than threads, so that the threads can balance the load.
+         */
+        static inline size_t chunk_count(const size_t size, unsigned int& threadCount) {
+            if (threadCount == 0)
+                threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+                threadCount = 1;
+
+            size_t chunkCount = threadCount * 4;
+            if (chunkCount > size / (64 * 1024))
+                chunkCount = size / (64 * 1024);
+            if (chunkCount == 0)
+                chunkCount = 1;
+            return chunkCount;
+        }
+
+        /**
+         * Decode all frames of a chunk using decode_frames() and append them to
+         * the frame table. The offsets are relative to base.
+         *
+         * @return The number of bytes processed
+         */
+        template <uint8_t Delimiter>
+        static inline size_t decode_chunk(uint8_t* base, uint8_t* chunk, const size_t size, std::vector<FrameInfo>& frames) {
+            FrameInfo table[1024];
+            size_t processed = 0;
+            for (;;) {
+                size_t consumed;
+                const size_t frameCount = decode_frames<Delimiter>(chunk + processed, size - processed, table, 1024, &consumed);
+                for (size_t i = 0; i < frameCount; i++) {
+                    table[i].offset += chunk + processed - base;
+                    frames.push_back(table[i]);
+                }
+                processed += consumed;
+                if (frameCount < 1024)
+                    return processed;
+            }
+        }
+    }   // Namespace detail
+
+    /**
+     * Decode all frames of a buffer in place using multiple threads. The buffer
+     * is split into chunks, whose boundaries are moved to the next delimiter, so
+     * that each chunk contains complete frames only and can be decoded
+     * independently. The result is identical to decode_frames() with an
+     * unlimited frame table.
+     *
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param buffer The i/o buffer containing the encoded frames
+     * @param size The size of the buffer
+     * @param threadCount The number of worker threads. 0 selects the number of CPU cores.
+     * @param consumed Optional. Returns the number of bytes processed. Any bytes after
+     * the last delimiter belong to an incomplete frame and are not touched.
+     * @return The frame table in the original order of the frames
+     */
+    template <uint8_t Delimiter = 0x00>
+    static std::vector<FrameInfo> decode_frames_parallel(uint8_t* buffer, const size_t size, unsigned int threadCount = 0, size_t* consumed = NULL) {
+        const size_t chunkCount = detail::chunk_count(size, threadCount);
+
+        // Align the chunk boundaries to the frame delimiters
+        std::vector<size_t> boundaries(chunkCount + 1);
+        boundaries[0] = 0;
+        for (size_t i = 1; i < chunkCount; i++) {
+            size_t boundary = size / chunkCount * i;
+            if (boundary < boundaries[i - 1])
+                boundary = boundaries[i - 1];
+            const uint8_t* delimiter = static_cast<const uint8_t*>(memchr(buffer + boundary, Delimiter, size - boundary));
+            boundaries[i] = delimiter == NULL ? size : delimiter - buffer + 1;
+        }
+        boundaries[chunkCount] = size;
+
+        std::vector<std::vector<FrameInfo> > results(chunkCount);
+        std::vector<size_t> processed(chunkCount);
+        detail::parallel_for(chunkCount, threadCount, [&](const size_t chunk) {
+            processed[chunk] = detail::decode_chunk<Delimiter>(buffer, buffer + boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk], results[chunk]);
+        });
+
+        // Only the last non-empty chunk may end with an incomplete frame. If the
+        // incomplete frame is longer than a chunk, no delimiter was found for the
+        // following boundaries and those chunks are empty.
+        if (consumed != NULL) {
+            size_t last = chunkCount - 1;
+            while (last > 0 and boundaries[last] == size)
+                last--;
+            *consumed = boundaries[last] + processed[last];
+        }
+
+        size_t frameCount = 0;
+        for (size_t i = 0; i < chunkCount; i++) {
+            frameCount += results[i].size();
+        }
+        std::vector<FrameInfo> frames;
+        frames.reserve(frameCount);
+        for (size_t i = 0; i < chunkCount; i++) {
+            frames.insert(frames.end(), results[i].begin(), results[i].end());
+        }
+        return frames;
+    }
+
+    namespace detail {
+        /**
+         * Calculate the exact encoded size of a part of a frame, that starts at a
+         * group boundary. See encode_groups().
+         */
+        static inline size_t encoded_size(const uint8_t* source, const size_t size, const bool endOfFrame) {
+            const uint8_t* endOfSource = source + size;
+            size_t encodedSize = 0;
+            for (;;) {
+                const uint8_t* zero = static_cast<const uint8_t*>(memchr(source, 0x00, endOfSource - source));
+                const size_t length = (zero == NULL ? endOfSource : zero) - source;
+                if (zero == NULL) {
+                    // The last segment is not terminated by a 0x00. At the end of the frame a full
+                    // group is not followed by an empty one, otherwise the part ends with a full group.
+                    if (endOfFrame)
+                        return encodedSize + (length == 0 ? 1 : length + (length + 253) / 254);
+                    return encodedSize + length + length / 254;
+                }
+                // One code byte per full group and one, that replaces the 0x00
+                encodedSize += length + length / 254 + 1;
+                source = zero + 1;
+            }
+        }
+    }   // Namespace detail
+
+    /**
+     * Encode a large frame using multiple threads. The output is identical to
+     * encode_to(). The input is split into chunks, that start at group boundaries,
+     * i.e. after a 0x00 or a full group. A first parallel pass calculates the
+     * encoded size of every chunk, which yields the output offset of each chunk.
+     * The second pass encodes the chunks concurrently into the output buffer.
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param source The data to be encoded. It will not be modified.
+     * @param size The number of bytes in source
+     * @param destination The output buffer. It must not overlap the source.
+     * @param capacity The size of the output buffer. Must be at least max_encoded_size(size)
+     * @param threadCount The number of worker threads. 0 selects the number of CPU cores.
+     * @return The encoded size of the data or 0 if the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_to_parallel(const uint8_t* source, const size_t size, uint8_t* destination, const size_t capacity, unsigned int threadCount = 0) {
+        if (capacity < max_encoded_size(size))
+            return 0;
+
+        const size_t chunkCount = detail::chunk_count(size, threadCount);
+
+        // Move the chunk boundaries to the next group boundary. Within a run of
+        // non-zero bytes, the groups start every 254 bytes after the last 0x00.
+        // The previous boundary is a group boundary as well, which limits the
+        // backward search for the 0x00.
+        std::vector<size_t> boundaries(chunkCount + 1);
+        boundaries[0] = 0;
+        for (size_t i = 1; i < chunkCount; i++) {
+            const size_t previous = boundaries[i - 1];
+            const size_t target = size / chunkCount * i;
+            if (target <= previous) {
+                boundaries[i] = previous;
+                continue;
+            }
+            // Search backwards for the last 0x00 in front of the target
+            size_t startOfRun = target;
+            while (startOfRun > previous and source[startOfRun - 1] != 0x00) {
+                startOfRun--;
+            }
+            size_t boundary = startOfRun + (target - startOfRun + 253) / 254 * 254;
+            if (boundary > size)
+                boundary = size;
+            // The run may end with a 0x00 before reaching the next full group
+            const uint8_t* zero = static_cast<const uint8_t*>(memchr(source + target, 0x00, boundary - target));
+            boundaries[i] = zero == NULL ? boundary : zero - source + 1;
+        }
+        boundaries[chunkCount] = size;
+
+        // The chunk, that ends the frame, is the only one, which must be
+        // encoded as such. Empty chunks after it produce no output.
+        std::vector<size_t> offsets(chunkCount + 1);
+        auto isEndOfFrame = [&](const size_t chunk) {
+            return boundaries[chunk + 1] == size and (boundaries[chunk] < size or chunk == 0);
+        };
+        detail::parallel_for(chunkCount, threadCount, [&](const size_t chunk) {
+            offsets[chunk + 1] = detail::encoded_size(source + boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk], isEndOfFrame(chunk));
+        });
+        offsets[0] = 0;
+        for (size_t i = 0; i < chunkCount; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        detail::parallel_for(chunkCount, threadCount, [&](const size_t chunk) {
+            if (boundaries[chunk + 1] != boundaries[chunk] or isEndOfFrame(chunk))
+                detail::encode_groups<Delimiter>(source + boundaries[chunk], boundaries[chunk + 1] - boundaries[chunk], destination + offsets[chunk], isEndOfFrame(chunk));
+        });
+
+        return offsets[chunkCount];
+    }
+}   // Namespace cobs
+#endif  // COBS_PARALLEL_CPP_H
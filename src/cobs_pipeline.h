@@ -0,0 +1,147 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_PIPELINE_CPP_H
+#define COBS_PIPELINE_CPP_H
+
+/**
+ * A lock-free pipeline between a thread, that reads the raw byte stream, and a
+ * thread, that processes the decoded frames. This requires std::atomic and is
+ * meant for hosts.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memcpy
+
+#include <atomic>
+
+#include "cobs.h"
+#include "cobs_stream.h"
+
+namespace cobs {
+    /**
+     * A single producer, single consumer ring buffer, that turns a stream of
+     * encoded bytes into decoded frames. The producer thread pushes raw bytes,
+     * e.g. straight from read(), the consumer thread polls for frames. Neither
+     * side uses locks or allocates memory. The frames are decoded by the
+     * consumer using a StreamDecoder, so the producer only copies bytes.
+     *
+     * @tparam RingSize The size of the ring buffer in bytes. Must be a power of two.
+     * @tparam FrameCapacity The maximum size of a decoded frame. Larger frames are discarded.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     */
+    template <size_t RingSize, size_t FrameCapacity = 254, uint8_t Delimiter = 0x00>
+    class FramePipeline {
+        static_assert(RingSize > 0 and (RingSize & (RingSize - 1)) == 0, "The ring size must be a power of two");
+
+      public:
+        FramePipeline() : head(0), cachedTail(0), tail(0), cachedHead(0) {}
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        /**
+         * Append raw bytes to the ring. Only call this from the producer thread.
+         *
+         * @param data The encoded data
+         * @param size The number of bytes
+         * @return The number of bytes accepted, which is less than size if the ring is full
+         */
+        size_t push(const uint8_t* data, size_t size) {
+            const size_t position = head.load(std::memory_order_relaxed);
+            // Only reload the position of the consumer, if the ring looks full
+            if (size > RingSize - (position - cachedTail)) {
+                cachedTail = tail.load(std::memory_order_acquire);
+                if (size > RingSize - (position - cachedTail))
+                    size = RingSize - (position - cachedTail);
+            }
+
+            const size_t index = position & (RingSize - 1);
+            const size_t firstPart = size < RingSize - index ? size : RingSize - index;
+            memcpy(&ring[index], data, firstPart);
+            memcpy(ring, data + firstPart, size - firstPart);
+            head.store(position + size, std::memory_order_release);
+            return size;
+        }
+
+        /**
+         * Decode all bytes pushed so far. Every completed frame is handed to the
+         * callback. Only call this from the consumer thread.
+         *
+         * @param callback A function or functor called as callback(const uint8_t* frame, size_t length).
+         * The frame is only valid for the duration of the callback.
+         * @return The number of frames handed to the callback
+         */
+        template <typename Callback>
+        size_t poll(Callback callback) {
+            const size_t position = tail.load(std::memory_order_relaxed);
+            if (position == cachedHead) {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (position == cachedHead)
+                    return 0;
+            }
+
+            const size_t available = cachedHead - position;
+            const size_t index = position & (RingSize - 1);
+            const size_t firstPart = available < RingSize - index ? available : RingSize - index;
+            size_t frameCount = 0;
+            auto counter = [&frameCount, &callback](const uint8_t* frame, size_t length) {
+                frameCount++;
+                callback(frame, length);
+            };
+            decoder.feed(&ring[index], firstPart, counter);
+            decoder.feed(ring, available - firstPart, counter);
+            // The bytes are consumed, the producer may overwrite them now
+            tail.store(cachedHead, std::memory_order_release);
+            return frameCount;
+        }
+
+        /**
+         * @return The number of frames discarded by the decoder. Only call this from the consumer thread.
+         */
+        size_t discarded() const {
+            return decoder.discarded();
+        }
+
+#ifdef COBS_STATS
+        /**
+         * @return The statistics of the decoder. The counters may be read from any thread.
+         */
+        const Statistics& statistics() const {
+            return decoder.statistics();
+        }
+#endif
+
+      private:
+        uint8_t ring[RingSize];
+        // The positions are counted in bytes since the start and are never
+        // wrapped. Each side keeps a copy of the position of the other side and
+        // the positions are on separate cache lines to avoid false sharing.
+        alignas(64) std::atomic<size_t> head;  // Written by the producer
+        size_t cachedTail;
+        alignas(64) std::atomic<size_t> tail;  // Written by the consumer
+        size_t cachedHead;
+        StreamDecoder<FrameCapacity, Delimiter> decoder;
+    };
+}   // Namespace cobs
+#endif  // COBS_PIPELINE_CPP_H
@@ -0,0 +1,129 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_POOL_CPP_H
+#define COBS_POOL_CPP_H
+
+/**
+ * Fixed size storage for received frames, that does not use the heap. This
+ * header does not need the standard library, so it can be used on
+ * microcontrollers. See cobs_concurrent_pool.h for a pool, that can be shared
+ * by several threads.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memcpy
+
+#include "cobs.h"
+
+namespace cobs {
+    /**
+     * A pool of fixed size slots for frames. The slots are kept in a free list,
+     * that is threaded through the free slots themselves, so the pool does not
+     * need any memory besides the slots. Acquiring and releasing a slot takes
+     * constant time. Declare the pool static to place it in static storage.
+     * The pool is not thread safe and must not be used from interrupts and the
+     * main loop at the same time.
+     *
+     * @tparam SlotCount The number of slots
+     * @tparam SlotSize The size of each slot. The default fits the largest single block frame, either encoded or decoded.
+     */
+    template <size_t SlotCount, size_t SlotSize = max_encoded_size(254)>
+    class FramePool {
+        static_assert(SlotCount > 0, "The pool needs at least one slot");
+        static_assert(SlotSize >= sizeof(uint8_t*), "A slot must be able to hold a pointer");
+
+      public:
+        static const size_t SLOT_COUNT = SlotCount;
+        static const size_t SLOT_SIZE = SlotSize;
+
+        FramePool() : freeList(slots[0]), freeCount(SlotCount) {
+            for (size_t i = 0; i < SlotCount; i++) {
+                uint8_t* next = i + 1 < SlotCount ? slots[i + 1] : NULL;
+                memcpy(slots[i], &next, sizeof(next));
+            }
+        }
+        FramePool(const FramePool&) = delete;
+        FramePool& operator=(const FramePool&) = delete;
+
+        /**
+         * @return A slot of SLOT_SIZE bytes or NULL if all slots are in use
+         */
+        uint8_t* acquire() {
+            uint8_t* slot = freeList;
+            if (slot != NULL) {
+                memcpy(&freeList, slot, sizeof(freeList));
+                freeCount--;
+            }
+            return slot;
+        }
+
+        /**
+         * Return a slot to the pool. The slot must have been acquired from this pool.
+         */
+        void release(uint8_t* slot) {
+            memcpy(slot, &freeList, sizeof(freeList));
+            freeList = slot;
+            freeCount++;
+        }
+
+        /**
+         * @return The number of free slots
+         */
+        size_t available() const {
+            return freeCount;
+        }
+
+      private:
+        uint8_t slots[SlotCount][SlotSize];
+        uint8_t* freeList;  // The first free slot, which holds a pointer to the next one
+        size_t freeCount;
+    };
+
+    /**
+     * Decode a frame straight into a slot of a pool. This works with both
+     * FramePool and ConcurrentFramePool.
+     *
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @param pool The pool
+     * @param source The encoded data, without the delimiter/framing byte. It will not be modified.
+     * @param size The size of the encoded data
+     * @param length The decoded size of the frame
+     * @return The slot holding the decoded frame, which must be released to the pool, or NULL if the pool
+     * is exhausted or the frame is empty, invalid or larger than a slot
+     */
+    template <uint8_t Delimiter = 0x00, typename Pool>
+    static uint8_t* decode_to_pool(Pool& pool, const uint8_t* source, const size_t size, size_t& length) {
+        uint8_t* slot = pool.acquire();
+        if (slot == NULL)
+            return NULL;
+        length = decode_to<Delimiter>(source, size, slot, Pool::SLOT_SIZE);
+        if (length == 0) {
+            pool.release(slot);
+            return NULL;
+        }
+        return slot;
+    }
+}   // Namespace cobs
+#endif  // COBS_POOL_CPP_H
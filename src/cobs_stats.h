@@ -0,0 +1,305 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_STATS_CPP_H
+#define COBS_STATS_CPP_H
+
+/**
+ * Optional statistics of the encoders and decoders. This header is included by
+ * cobs.h, if COBS_STATS is defined, and requires std::atomic and thread_local.
+ * Define COBS_STATS_TIMING as well to measure the time spent in the functions
+ * using std::chrono::steady_clock and COBS_STATS_HISTOGRAM to keep histograms
+ * of the frame sizes and group counts. Without COBS_STATS the hooks are empty
+ * and the functions compile to the same code as before.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+
+#include <atomic>
+#include <mutex>
+#ifdef COBS_STATS_TIMING
+#include <chrono>
+#endif
+
+namespace cobs {
+    enum class Status : uint8_t;
+
+    /**
+     * Counters of a decoder instance or of the free functions of one thread.
+     * Every set of counters is only written by a single thread, so the counters
+     * are updated using relaxed loads and stores instead of atomic read-modify-write
+     * operations. They can be read by any thread. The counters of a single frame
+     * are not updated atomically as a whole.
+     */
+    struct Statistics {
+        // The number of statuses, that can be reported by record_error()
+        static const size_t STATUS_COUNT = 6;
+#ifdef COBS_STATS_HISTOGRAM
+        // Frame sizes and group counts are recorded in buckets of powers of two. Bucket 0
+        // holds the value 0, bucket n holds the values in the range [2^(n - 1), 2^n). The
+        // last bucket holds all values from 2^15 upwards.
+        static const size_t HISTOGRAM_BUCKETS = 17;
+#endif
+
+        Statistics() {
+            reset();
+        }
+        Statistics(const Statistics&) = delete;
+        Statistics& operator=(const Statistics&) = delete;
+
+        void reset() {
+            encodedFrames.store(0, std::memory_order_relaxed);
+            encodedBytesIn.store(0, std::memory_order_relaxed);
+            encodedBytesOut.store(0, std::memory_order_relaxed);
+            decodedFrames.store(0, std::memory_order_relaxed);
+            decodedBytesIn.store(0, std::memory_order_relaxed);
+            decodedBytesOut.store(0, std::memory_order_relaxed);
+            encodeNanoseconds.store(0, std::memory_order_relaxed);
+            decodeNanoseconds.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < STATUS_COUNT; i++) {
+                errors[i].store(0, std::memory_order_relaxed);
+            }
+#ifdef COBS_STATS_HISTOGRAM
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                frameSizes[i].store(0, std::memory_order_relaxed);
+                groupCounts[i].store(0, std::memory_order_relaxed);
+            }
+#endif
+        }
+
+        /**
+         * Add the counters of another set, e.g. to sum up the counters of all threads.
+         * Unlike the record_*() functions, this must not race with other writers.
+         */
+        void add(const Statistics& other) {
+            increment(encodedFrames, other.encodedFrames.load(std::memory_order_relaxed));
+            increment(encodedBytesIn, other.encodedBytesIn.load(std::memory_order_relaxed));
+            increment(encodedBytesOut, other.encodedBytesOut.load(std::memory_order_relaxed));
+            increment(decodedFrames, other.decodedFrames.load(std::memory_order_relaxed));
+            increment(decodedBytesIn, other.decodedBytesIn.load(std::memory_order_relaxed));
+            increment(decodedBytesOut, other.decodedBytesOut.load(std::memory_order_relaxed));
+            increment(encodeNanoseconds, other.encodeNanoseconds.load(std::memory_order_relaxed));
+            increment(decodeNanoseconds, other.decodeNanoseconds.load(std::memory_order_relaxed));
+            for (size_t i = 0; i < STATUS_COUNT; i++) {
+                increment(errors[i], other.errors[i].load(std::memory_order_relaxed));
+            }
+#ifdef COBS_STATS_HISTOGRAM
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                increment(frameSizes[i], other.frameSizes[i].load(std::memory_order_relaxed));
+                increment(groupCounts[i], other.groupCounts[i].load(std::memory_order_relaxed));
+            }
+#endif
+        }
+
+#ifdef COBS_STATS_HISTOGRAM
+        /**
+         * @return The bucket of the histograms, that holds the value
+         */
+        static size_t bucket(const size_t value) {
+            if (value == 0)
+                return 0;
+            const size_t index = 8 * sizeof(unsigned long long) - __builtin_clzll(value);
+            return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+        }
+#endif
+
+        /**
+         * @param size The size of the payload
+         * @param encodedSize The size of the encoded frame
+         */
+        void record_encode(const size_t size, const size_t encodedSize) {
+            increment(encodedFrames, 1);
+            increment(encodedBytesIn, size);
+            increment(encodedBytesOut, encodedSize);
+#ifdef COBS_STATS_HISTOGRAM
+            increment(frameSizes[bucket(size)], 1);
+#endif
+        }
+
+        /**
+         * @param encodedSize The size of the encoded frame
+         * @param size The size of the decoded payload
+         * @param groups The number of groups in the frame
+         */
+        void record_decode(const size_t encodedSize, const size_t size, const size_t groups) {
+            increment(decodedFrames, 1);
+            increment(decodedBytesIn, encodedSize);
+            increment(decodedBytesOut, size);
+#ifdef COBS_STATS_HISTOGRAM
+            increment(frameSizes[bucket(size)], 1);
+            increment(groupCounts[bucket(groups)], 1);
+#else
+            (void)groups;
+#endif
+        }
+
+        void record_error(const Status status) {
+            increment(errors[static_cast<size_t>(status)], 1);
+        }
+
+        /**
+         * @return The number of errors with the given cause
+         */
+        size_t error_count(const Status status) const {
+            return errors[static_cast<size_t>(status)].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Add to a counter, that has a single writer. This avoids the locked
+         * instruction of fetch_add().
+         */
+        static void increment(std::atomic<size_t>& counter, const size_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic<size_t> encodedFrames;
+        std::atomic<size_t> encodedBytesIn;  // The payload
+        std::atomic<size_t> encodedBytesOut;  // The encoded data without the delimiter
+        std::atomic<size_t> decodedFrames;
+        std::atomic<size_t> decodedBytesIn;  // The encoded data
+        std::atomic<size_t> decodedBytesOut;  // The payload
+        std::atomic<size_t> errors[STATUS_COUNT];  // Indexed by Status
+#ifdef COBS_STATS_HISTOGRAM
+        std::atomic<size_t> frameSizes[HISTOGRAM_BUCKETS];  // The payload sizes of all frames
+        std::atomic<size_t> groupCounts[HISTOGRAM_BUCKETS];  // The groups per decoded frame
+#endif
+        std::atomic<size_t> encodeNanoseconds;  // Only with COBS_STATS_TIMING
+        std::atomic<size_t> decodeNanoseconds;  // Only with COBS_STATS_TIMING
+    };
+
+    namespace detail {
+        struct StatisticsShard;
+
+        /**
+         * The list of the statistics of all threads. The lock is only taken,
+         * when a thread starts or stops using the library and when the
+         * statistics are read, never by the encoders and decoders.
+         */
+        struct StatisticsRegistry {
+            static StatisticsRegistry& instance() {
+                static StatisticsRegistry registry;
+                return registry;
+            }
+
+            std::mutex mutex;
+            StatisticsShard* shards = NULL;
+            Statistics retired;  // The counters of the threads, that have exited
+        };
+
+        /**
+         * The statistics of the free functions called by one thread
+         */
+        struct StatisticsShard : Statistics {
+            StatisticsShard() {
+                StatisticsRegistry& registry = StatisticsRegistry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                next = registry.shards;
+                registry.shards = this;
+            }
+            ~StatisticsShard() {
+                StatisticsRegistry& registry = StatisticsRegistry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.retired.add(*this);
+                StatisticsShard** shard = &registry.shards;
+                while (*shard != this) {
+                    shard = &(*shard)->next;
+                }
+                *shard = next;
+            }
+
+            StatisticsShard* next;
+        };
+
+        /**
+         * @return The statistics of the free functions of the calling thread
+         */
+        inline Statistics& thread_statistics() {
+            thread_local StatisticsShard shard;
+            return shard;
+        }
+    }   // Namespace detail
+
+    /**
+     * Sum up the statistics of the free functions of all threads. Every thread
+     * counts into its own set of counters, so threads running the encoders and
+     * decoders in parallel do not contend for the same cache lines.
+     *
+     * @param total Receives the sum. Its previous counts are discarded.
+     */
+    inline void collect_statistics(Statistics& total) {
+        detail::StatisticsRegistry& registry = detail::StatisticsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        total.reset();
+        total.add(registry.retired);
+        for (detail::StatisticsShard* shard = registry.shards; shard != NULL; shard = shard->next) {
+            total.add(*shard);
+        }
+    }
+
+    /**
+     * Reset the statistics of the free functions of all threads. Counts
+     * recorded by other threads at the same time may survive the reset.
+     */
+    inline void reset_statistics() {
+        detail::StatisticsRegistry& registry = detail::StatisticsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.retired.reset();
+        for (detail::StatisticsShard* shard = registry.shards; shard != NULL; shard = shard->next) {
+            shard->reset();
+        }
+    }
+
+#ifdef COBS_STATS_TIMING
+    namespace detail {
+        /**
+         * Adds the time from its construction to its destruction to a counter.
+         */
+        class StatsTimer {
+          public:
+            explicit StatsTimer(std::atomic<size_t>& counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+            ~StatsTimer() {
+                const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+                Statistics::increment(counter, elapsed.count());
+            }
+
+          private:
+            std::atomic<size_t>& counter;
+            std::chrono::steady_clock::time_point start;
+        };
+    }   // Namespace detail
+#endif
+}   // Namespace cobs
+
+// The hooks used by the encoders and decoders
+#define COBS_STATS_ONLY(statement) statement
+#define COBS_STATS_ENCODE(size, encodedSize) ::cobs::detail::thread_statistics().record_encode(size, encodedSize)
+#define COBS_STATS_DECODE(encodedSize, size, groups) ::cobs::detail::thread_statistics().record_decode(encodedSize, size, groups)
+#define COBS_STATS_ERROR(status) ::cobs::detail::thread_statistics().record_error(status)
+#ifdef COBS_STATS_TIMING
+#define COBS_STATS_TIMER(counter) ::cobs::detail::StatsTimer cobsStatsTimer(::cobs::detail::thread_statistics().counter)
+#else
+#define COBS_STATS_TIMER(counter)
+#endif
+
+#endif  // COBS_STATS_CPP_H
@@ -0,0 +1,358 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_STREAM_CPP_H
+#define COBS_STREAM_CPP_H
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr, memcpy
+
+#include "cobs.h"
+
+namespace cobs {
+    /**
+     * Incremental COBS decoder for byte streams, that are delimited by 0x00.
+     * The input can be fed in chunks of arbitrary size, for example directly
+     * from a serial read(). The decoder keeps track of the current group across
+     * calls, so every byte is processed exactly once and decoded straight into
+     * the internal frame buffer. The decoder does not allocate any memory.
+     *
+     * Frames that are truncated (a delimiter inside a group), malformed or that
+     * do not fit into the frame buffer are discarded. Empty frames, i.e.
+     * consecutive delimiters, are skipped.
+     *
+     * @tparam Capacity The maximum size of a decoded frame
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     */
+    template <size_t Capacity = 254, uint8_t Delimiter = 0x00>
+    class StreamDecoder {
+      public:
+        StreamDecoder() : length(0), remaining(0), code(0), inFrame(false), invalid(false), discardedFrames(0) {
+            COBS_STATS_ONLY(encodedLength = 0);
+            COBS_STATS_ONLY(groups = 0);
+        }
+
+        /**
+         * Decode a chunk of the input stream. Every completed frame is handed to the
+         * callback. The frame is only valid for the duration of the callback.
+         *
+         * @param data The chunk of encoded data
+         * @param size The size of the chunk
+         * @param callback A function or functor called as callback(const uint8_t* frame, size_t length)
+         */
+        template <typename Callback>
+        void feed(const uint8_t* data, const size_t size, Callback callback) {
+            const uint8_t* endOfData = data + size;
+
+            while (data < endOfData) {
+                if (*data == Delimiter) {
+                    // End of frame. It is only valid if the last group is complete.
+                    if (inFrame) {
+                        if (remaining == 0 and not invalid) {
+                            COBS_STATS_ONLY(stats.record_decode(encodedLength, length, groups));
+                            callback(static_cast<const uint8_t*>(frame), length);
+                        } else {
+                            COBS_STATS_ONLY(stats.record_error(invalid ? Status::OVERSIZE : Status::OUT_OF_RANGE));
+                            discardedFrames++;
+                        }
+                    }
+                    reset();
+                    data++;
+                    continue;
+                }
+
+                if (remaining == 0) {
+                    // This is a code byte. Every group, except a full one, ends
+                    // with an implicit 0x00, unless it is the last one.
+                    if (inFrame and code != 0xFF)
+                        append(Delimiter);  // This is decoded to 0x00
+                    code = *data++ ^ Delimiter;
+                    remaining = code - 1;
+                    inFrame = true;
+                    COBS_STATS_ONLY(encodedLength++);
+                    COBS_STATS_ONLY(groups++);
+                    continue;
+                }
+
+                // Copy as much of the group as is available in this chunk. A 0x00
+                // inside the group is the delimiter of a truncated frame.
+                size_t chunkSize = endOfData - data;
+                if (chunkSize > remaining)
+                    chunkSize = remaining;
+                const uint8_t* delimiter = static_cast<const uint8_t*>(memchr(data, Delimiter, chunkSize));
+                if (delimiter != NULL)
+                    chunkSize = delimiter - data;
+                append(data, chunkSize);
+                remaining -= chunkSize;
+                data += chunkSize;
+                COBS_STATS_ONLY(encodedLength += chunkSize);
+            }
+        }
+
+        /**
+         * Discard the partially decoded frame and wait for the next one.
+         * Use this to resynchronize the decoder, for example after a line error.
+         */
+        void reset() {
+            length = 0;
+            remaining = 0;
+            code = 0;
+            inFrame = false;
+            invalid = false;
+            COBS_STATS_ONLY(encodedLength = 0);
+            COBS_STATS_ONLY(groups = 0);
+        }
+
+        /**
+         * @return The number of frames discarded, because they were invalid or too large
+         */
+        size_t discarded() const {
+            return discardedFrames;
+        }
+
+#ifdef COBS_STATS
+        /**
+         * @return The statistics of this decoder. The discarded frames are
+         * reported as Status::OVERSIZE, if they are too large, otherwise as
+         * Status::OUT_OF_RANGE.
+         */
+        const Statistics& statistics() const {
+            return stats;
+        }
+#endif
+
+      private:
+        void append(const uint8_t value) {
+            append(&value, 1);
+        }
+
+        void append(const uint8_t* data, const size_t size) {
+            if (invalid)
+                return;
+            if (size > Capacity - length) {
+                // The frame is too large and will be dropped at the next delimiter
+                invalid = true;
+                return;
+            }
+            detail::copy_xor<Delimiter>(&frame[length], data, size);
+            length += size;
+        }
+
+        uint8_t frame[Capacity];
+        size_t length;  // The number of bytes decoded so far
+        uint8_t remaining;  // The number of data bytes left in the current group
+        uint8_t code;  // The code byte of the current group
+        bool inFrame;  // At least one code byte was received since the last delimiter
+        bool invalid;  // The current frame will be discarded
+        size_t discardedFrames;
+#ifdef COBS_STATS
+        size_t encodedLength;  // The encoded size of the current frame
+        size_t groups;  // The number of groups of the current frame
+        Statistics stats;
+#endif
+    };
+
+    /**
+     * Incremental COBS encoder. The payload can be written in chunks of
+     * arbitrary size and every group is emitted as soon as it is complete, i.e.
+     * when a 0x00 is written or 254 non-zero bytes have accumulated. Memory use
+     * is therefore limited to a single group, regardless of the size of the frame.
+     * The output is identical to encode_to() followed by the delimiter.
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     */
+    template <uint8_t Delimiter>
+    class BasicStreamEncoder {
+      public:
+        BasicStreamEncoder() : length(1), afterFullGroup(false) {}
+
+        /**
+         * Encode a chunk of the payload. Completed groups are handed to the callback.
+         * The data is only valid for the duration of the callback.
+         *
+         * @param data The chunk of the payload
+         * @param size The size of the chunk
+         * @param callback A function or functor called as callback(const uint8_t* data, size_t length)
+         */
+        template <typename Callback>
+        void write(const uint8_t* data, const size_t size, Callback callback) {
+            const uint8_t* endOfData = data + size;
+
+            while (data < endOfData) {
+                // Fill the group up to the next 0x00 or until it is full
+                size_t chunkSize = endOfData - data;
+                if (chunkSize > (size_t)(255 - length))
+                    chunkSize = 255 - length;
+                const uint8_t* zero = static_cast<const uint8_t*>(memchr(data, 0x00, chunkSize));
+                if (zero != NULL)
+                    chunkSize = zero - data;
+                detail::copy_xor<Delimiter>(&group[length], data, chunkSize);
+                length += chunkSize;
+                data += chunkSize;
+
+                if (zero != NULL) {
+                    data++;  // The 0x00 is replaced by the code byte
+                    emit(callback, 0);
+                    afterFullGroup = false;
+                } else if (length == 255) {
+                    emit(callback, 0);
+                    afterFullGroup = true;
+                }
+            }
+        }
+
+        /**
+         * Complete the frame. The remaining group and the delimiter are handed
+         * to the callback. Afterwards the encoder is ready for the next frame.
+         *
+         * @param callback A function or functor called as callback(const uint8_t* data, size_t length)
+         */
+        template <typename Callback>
+        void finish(Callback callback) {
+            if (length == 1 and afterFullGroup) {
+                // A full group at the end of the frame is not followed by an empty group
+                group[0] = Delimiter;
+                callback(static_cast<const uint8_t*>(group), 1);
+            } else {
+                group[length] = Delimiter;
+                emit(callback, 1);
+            }
+            afterFullGroup = false;
+        }
+
+      private:
+        template <typename Callback>
+        void emit(Callback& callback, const size_t trailer) {
+            group[0] = length ^ Delimiter;
+            callback(static_cast<const uint8_t*>(group), length + trailer);
+            length = 1;
+        }
+
+        uint8_t group[256];  // The code byte, up to 254 data bytes and the delimiter
+        size_t length;  // The size of the current group including the code byte
+        bool afterFullGroup;  // The previous group was a full group
+    };
+
+    /**
+     * The incremental COBS encoder for the default delimiter 0x00.
+     */
+    typedef BasicStreamEncoder<0x00> StreamEncoder;
+
+    /**
+     * Encode a frame and hand it to a sink group by group, without an
+     * intermediate buffer. For every group the code byte is passed to the sink
+     * first, followed by the data of the group, which is passed straight from
+     * the source. Finally the delimiter is appended. The output is identical to
+     * encode_to() followed by the delimiter.
+     *
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @param source The data to be encoded. It will not be modified.
+     * @param size The number of bytes in source
+     * @param sink A function or functor called as sink(const uint8_t* data, size_t length), e.g. a RingSink.
+     * The data is only valid for the duration of the call.
+     * @return The number of bytes passed to the sink, including the delimiter
+     */
+    template <uint8_t Delimiter = 0x00, typename Sink>
+    static size_t encode_to_sink(const uint8_t* source, const size_t size, Sink sink) {
+        const uint8_t* endOfSource = source + size;
+        size_t encodedSize = 0;
+
+        // The frame always starts with a group. A full group at the end of the
+        // frame is not followed by an empty group.
+        do {
+            size_t length = endOfSource - source;
+            if (length > 254)
+                length = 254;
+            // The source of an empty frame may be NULL, which must not be passed to memchr()
+            const uint8_t* zero = length == 0 ? NULL : static_cast<const uint8_t*>(memchr(source, 0x00, length));
+            if (zero != NULL)
+                length = zero - source;
+            const uint8_t code = (length + 1) ^ Delimiter;
+            sink(&code, 1);
+
+            if (length == 0) {
+                // The group has no data
+            } else if (Delimiter == 0x00) {
+                sink(source, length);
+            } else {
+                // The data must be XORed with the delimiter, which needs a copy
+                uint8_t chunk[32];
+                for (size_t offset = 0; offset < length; offset += sizeof(chunk)) {
+                    const size_t chunkSize = length - offset < sizeof(chunk) ? length - offset : sizeof(chunk);
+                    detail::copy_xor<Delimiter>(chunk, &source[offset], chunkSize);
+                    sink(static_cast<const uint8_t*>(chunk), chunkSize);
+                }
+            }
+            encodedSize += length + 1;
+            source += length;
+            if (zero != NULL) {
+                source++;  // The 0x00 is replaced by the code byte of the next group
+                if (source == endOfSource) {
+                    // The frame ends with a 0x00, which is followed by an empty group
+                    const uint8_t empty = 0x01 ^ Delimiter;
+                    sink(&empty, 1);
+                    encodedSize++;
+                }
+            }
+        } while (source < endOfSource);
+
+        const uint8_t delimiter = Delimiter;
+        sink(&delimiter, 1);
+        return encodedSize + 1;
+    }
+
+    /**
+     * A sink for encode_to_sink(), that writes into a ring buffer, e.g. the
+     * transmit buffer of a UART or a circular DMA buffer. Writes, that cross the
+     * end of the buffer, wrap around to the start. The sink does not check for
+     * free space, so the caller must make sure, that max_encoded_size(size) + 1
+     * bytes are free before encoding a frame.
+     */
+    class RingSink {
+      public:
+        /**
+         * @param buffer The ring buffer
+         * @param capacity The size of the ring buffer
+         * @param head The write position within the ring buffer. It is advanced by the sink.
+         */
+        RingSink(uint8_t* buffer, const size_t capacity, size_t& head) : buffer(buffer), capacity(capacity), head(head) {}
+
+        void operator()(const uint8_t* data, const size_t length) {
+            size_t firstPart = capacity - head;
+            if (firstPart > length)
+                firstPart = length;
+            memcpy(&buffer[head], data, firstPart);
+            memcpy(buffer, data + firstPart, length - firstPart);
+            head += length;
+            if (head >= capacity)
+                head -= capacity;
+        }
+
+      private:
+        uint8_t* buffer;
+        size_t capacity;
+        size_t& head;
+    };
+}   // Namespace cobs
+#endif  // COBS_STREAM_CPP_H
@@ -0,0 +1,270 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+*/
+#ifndef COBS_TRANSPORT_CPP_H
+#define COBS_TRANSPORT_CPP_H
+
+/**
+ * A transport for COBS framed data on many file descriptors, e.g. serial
+ * ports, ptys or pipes, serviced by a single thread. This requires Linux
+ * (epoll) and is not meant for microcontrollers.
+ */
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memmove
+#include <errno.h>  // errno
+#include <fcntl.h>  // fcntl
+#include <sys/epoll.h>  // epoll_create1, epoll_ctl, epoll_wait
+#include <unistd.h>  // close, read, write
+
+#include <map>
+
+#include "cobs.h"
+#include "cobs_stream.h"
+
+namespace cobs {
+    /**
+     * Reads, decodes, encodes and writes COBS frames on any number of non-blocking
+     * file descriptors using a single epoll instance. Every port has its own
+     * stream decoder and a transmit buffer. Frames sent to a port are encoded
+     * into its transmit buffer and written in batches, when poll() is called.
+     * If the transmit buffer is full, send() fails, so the caller can apply
+     * backpressure. The transport does not own the file descriptors.
+     *
+     * @tparam FrameCapacity The maximum size of a received frame. Larger frames are discarded.
+     * @tparam TxCapacity The size of the transmit buffer of each port
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     */
+    template <size_t FrameCapacity = 254, size_t TxCapacity = 4096, uint8_t Delimiter = 0x00>
+    class EpollTransport {
+      public:
+        EpollTransport() : epollFd(epoll_create1(EPOLL_CLOEXEC)) {}
+        ~EpollTransport() {
+            for (typename std::map<int, Port*>::iterator it = ports.begin(); it != ports.end(); ++it) {
+                delete it->second;
+            }
+            if (epollFd >= 0)
+                ::close(epollFd);
+        }
+        EpollTransport(const EpollTransport&) = delete;
+        EpollTransport& operator=(const EpollTransport&) = delete;
+
+        /**
+         * Start servicing a file descriptor. It is switched to non-blocking mode.
+         *
+         * @param fd The file descriptor, e.g. of a tty. It must be readable and writable.
+         * @return False if the file descriptor could not be added
+         */
+        bool add(const int fd) {
+            if (epollFd < 0 or ports.count(fd) != 0)
+                return false;
+            const int flags = fcntl(fd, F_GETFL);
+            if (flags < 0 or fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+                return false;
+
+            Port* port = new Port(fd);
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = port;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                delete port;
+                return false;
+            }
+            ports[fd] = port;
+            return true;
+        }
+
+        /**
+         * Stop servicing a file descriptor. Pending output is discarded. Do not
+         * call this from the callback of poll().
+         *
+         * @return False if the file descriptor was not added
+         */
+        bool remove(const int fd) {
+            typename std::map<int, Port*>::iterator it = ports.find(fd);
+            if (it == ports.end())
+                return false;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+            delete it->second;
+            ports.erase(it);
+            return true;
+        }
+
+        /**
+         * Encode a frame into the transmit buffer of a port. It is written by the
+         * next call to poll() or flush(). This may be called from the callback of poll().
+         *
+         * @param fd The port
+         * @param data The payload of the frame
+         * @param size The size of the payload
+         * @return False if the port is unknown or its transmit buffer is full
+         */
+        bool send(const int fd, const uint8_t* data, const size_t size) {
+            typename std::map<int, Port*>::iterator it = ports.find(fd);
+            if (it == ports.end())
+                return false;
+            Port& port = *it->second;
+
+            const size_t required = max_encoded_size(size) + 1;  // Including the delimiter
+            if (required > TxCapacity - port.txEnd) {
+                // Move the pending data to the front of the buffer to make room
+                memmove(port.tx, &port.tx[port.txStart], port.txEnd - port.txStart);
+                port.txEnd -= port.txStart;
+                port.txStart = 0;
+                if (required > TxCapacity - port.txEnd)
+                    return false;
+            }
+            port.txEnd += encode_to<Delimiter>(data, size, &port.tx[port.txEnd], TxCapacity - port.txEnd);
+            port.tx[port.txEnd++] = Delimiter;
+            return true;
+        }
+
+        /**
+         * @return The number of bytes waiting to be written to a port
+         */
+        size_t pending(const int fd) const {
+            typename std::map<int, Port*>::const_iterator it = ports.find(fd);
+            return it == ports.end() ? 0 : it->second->txEnd - it->second->txStart;
+        }
+
+#ifdef COBS_STATS
+        /**
+         * @return The statistics of the decoder of a port or NULL if the port is unknown.
+         * They are only valid until the port is removed.
+         */
+        const Statistics* statistics(const int fd) const {
+            typename std::map<int, Port*>::const_iterator it = ports.find(fd);
+            return it == ports.end() ? NULL : &it->second->decoder.statistics();
+        }
+#endif
+
+        /**
+         * Write as much of the pending output of all ports as possible without blocking.
+         */
+        void flush() {
+            for (typename std::map<int, Port*>::iterator it = ports.begin(); it != ports.end(); ++it) {
+                write_pending(*it->second);
+            }
+        }
+
+        /**
+         * Wait for input or for room to write output, then read and decode the
+         * input and write the pending output. Each ready port is read once per
+         * call, so a busy port cannot starve the others.
+         *
+         * @param timeout The maximum time to wait in ms, 0 to return immediately or -1 to wait forever
+         * @param callback A function or functor called as callback(int fd, const uint8_t* frame, size_t length)
+         * for every received frame. If a port is closed or fails, it is removed and the callback
+         * is called once with frame set to NULL.
+         * @return The number of frames received or -1 on error
+         */
+        template <typename Callback>
+        int poll(const int timeout, Callback callback) {
+            struct epoll_event events[64];
+            // Write the output queued since the last call before waiting
+            flush();
+            const int eventCount = epoll_wait(epollFd, events, sizeof(events) / sizeof(events[0]), timeout);
+            if (eventCount < 0)
+                return errno == EINTR ? 0 : -1;
+
+            int frameCount = 0;
+            int closed[64];
+            int closedCount = 0;
+            for (int i = 0; i < eventCount; i++) {
+                Port& port = *static_cast<Port*>(events[i].data.ptr);
+                bool failed = false;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    uint8_t chunk[4096];
+                    const ssize_t size = ::read(port.fd, chunk, sizeof(chunk));
+                    if (size > 0) {
+                        const int fd = port.fd;
+                        port.decoder.feed(chunk, size, [&](const uint8_t* frame, size_t length) {
+                            frameCount++;
+                            callback(fd, frame, length);
+                        });
+                    } else if (size == 0 or (errno != EAGAIN and errno != EINTR)) {
+                        // End of file or an error, e.g. EIO, if the other side of a pty was closed
+                        failed = true;
+                    }
+                }
+                if (not failed and (events[i].events & EPOLLOUT))
+                    failed = not write_pending(port);
+                if (failed)
+                    closed[closedCount++] = port.fd;
+            }
+            for (int i = 0; i < closedCount; i++) {
+                remove(closed[i]);
+                callback(closed[i], static_cast<const uint8_t*>(NULL), 0);
+            }
+
+            // Write the replies queued by the callback right away
+            flush();
+            return frameCount;
+        }
+
+      private:
+        struct Port {
+            explicit Port(const int fd) : fd(fd), txStart(0), txEnd(0), waitingForOutput(false) {}
+
+            int fd;
+            StreamDecoder<FrameCapacity, Delimiter> decoder;
+            uint8_t tx[TxCapacity];
+            size_t txStart;  // The first byte, that was not written yet
+            size_t txEnd;
+            bool waitingForOutput;  // EPOLLOUT is enabled, because the port is full
+        };
+
+        /**
+         * Write the pending output of a port with a single write() and wait for
+         * EPOLLOUT, if not all of it could be written.
+         *
+         * @return False if the port failed
+         */
+        bool write_pending(Port& port) {
+            if (port.txEnd != port.txStart) {
+                const ssize_t size = ::write(port.fd, &port.tx[port.txStart], port.txEnd - port.txStart);
+                if (size < 0 and errno != EAGAIN and errno != EINTR)
+                    return false;
+                if (size > 0)
+                    port.txStart += size;
+                if (port.txStart == port.txEnd)
+                    port.txStart = port.txEnd = 0;
+            }
+
+            const bool waitingForOutput = port.txEnd != port.txStart;
+            if (waitingForOutput != port.waitingForOutput) {
+                struct epoll_event event = {};
+                event.events = waitingForOutput ? EPOLLIN | EPOLLOUT : EPOLLIN;
+                event.data.ptr = &port;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, port.fd, &event);
+                port.waitingForOutput = waitingForOutput;
+            }
+            return true;
+        }
+
+        int epollFd;
+        std::map<int, Port*> ports;
+    };
+}   // Namespace cobs
+#endif  // COBS_TRANSPORT_CPP_H
@@ -0,0 +1,169 @@
+/**
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+# Copyright (C) 2022  Patrick Baus
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+@author Patrick Baus
+@version 1.2.0 04/15/2022
+
+COBS/ZPE (zero pair elimination) as described by Cheshire and Baker. The code
+bytes are used as follows:
+  0x01 - 0xDF: 0 - 222 data bytes followed by a 0x00
+  0xE0:        223 data bytes, not followed by a 0x00
+  0xE1 - 0xFF: 0 - 30 data bytes followed by two 0x00
+Pairs of zeros only cost a single code byte, so longer runs of zeros are
+compressed to half their size. Like COBS, the encoded data never contains 0x00.
+*/
+#ifndef COBS_ZPE_CPP_H
+#define COBS_ZPE_CPP_H
+
+#include <stdint.h>  // uint8_t, etc.
+#include <stddef.h>  // size_t
+#include <string.h>  // memchr
+
+#include "cobs.h"
+
+namespace cobs {
+    /**
+     * Calculate the worst case size of a COBS/ZPE encoded frame. Use this to size
+     * the output buffer of encode_zpe_to().
+     *
+     * @param size The number of (unencoded) data bytes
+     * @return The maximum number of bytes the encoder will produce, excluding the delimiter
+     */
+    static constexpr size_t max_zpe_encoded_size(const size_t size) {
+        // One code byte per started group of 223 bytes, but at least one,
+        // even for an empty frame
+        return size == 0 ? 1 : size + (size + 222) / 223;
+    }
+
+    /**
+     * Encode an input array of bytes of arbitrary length with the COBS/ZPE
+     * algorithm. The output must be decoded with decode_zpe_to().
+     *
+     * @param source The data to be encoded. It will not be modified.
+     * @param size The number of bytes in source
+     * @param destination The output buffer. It must not overlap the source.
+     * @param capacity The size of the output buffer. Must be at least max_zpe_encoded_size(size)
+     * @tparam Delimiter The byte, that does not occur in the encoded data. See encode().
+     * @return The encoded size of the data or 0 if the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t encode_zpe_to(const uint8_t* source, const size_t size, uint8_t* destination, const size_t capacity) {
+        if (capacity < max_zpe_encoded_size(size))
+            return 0;
+
+        uint8_t* cursor = destination;
+        // The position in the source. The frame is followed by an implicit 0x00,
+        // which terminates the last group. It is consumed, when position > size.
+        size_t position = 0;
+
+        while (true) {
+            const size_t remaining = size - position;
+            size_t length = remaining < 223 ? remaining : 223;
+            // The source of an empty frame may be NULL, which must not be passed to memchr()
+            const uint8_t* zero = NULL;
+            if (length != 0)
+                zero = static_cast<const uint8_t*>(memchr(source + position, 0x00, length));
+            if (zero != NULL)
+                length = zero - (source + position);
+
+            uint8_t code;
+            size_t zeros;
+            if (zero == NULL and length == 223) {
+                code = 0xE0;  // A full group
+                zeros = 0;
+            } else if (zero != NULL and length <= 30 and (position + length + 1 == size or source[position + length + 1] == 0x00)) {
+                // The 0x00 is followed by a second one, which might be the
+                // implicit 0x00 at the end of the frame.
+                code = 0xE1 + length;
+                zeros = 2;
+            } else {
+                code = length + 1;
+                zeros = 1;
+            }
+
+            *cursor++ = code ^ Delimiter;
+            detail::copy_xor<Delimiter>(cursor, source + position, length);
+            cursor += length;
+            position += length + zeros;
+
+            // Stop once the implicit 0x00 is consumed. A full group at the end of
+            // the frame is not followed by an empty group.
+            if (position > size or (zeros == 0 and position == size))
+                break;
+        }
+
+        return cursor - destination;
+    }
+
+    /**
+     * Decode a COBS/ZPE encoded frame of arbitrary length into a separate buffer.
+     * Every code byte is checked against both the input and the output buffer,
+     * so a corrupted frame can never cause reads or writes out of bounds.
+     *
+     * @param source The encoded data, without the delimiter/framing byte. It will not be modified.
+     * @param size The size of the encoded data
+     * @param destination The output buffer. It must not overlap the source.
+     * @param capacity The size of the output buffer. Because pairs of zeros are
+     * compressed, the decoded frame can be up to twice as large as the encoded one.
+     * @tparam Delimiter The delimiter used by the encoder. See encode().
+     * @return The decoded size of the data or 0 if the frame is invalid or the output buffer is too small
+     */
+    template <uint8_t Delimiter = 0x00>
+    static size_t decode_zpe_to(const uint8_t* source, const size_t size, uint8_t* destination, const size_t capacity) {
+        const uint8_t* endOfSource = source + size;
+        uint8_t* cursor = destination;
+        uint8_t* endOfDestination = destination + capacity;
+
+        while (source < endOfSource) {
+            const uint8_t code = *source++ ^ Delimiter;
+            if (code == 0) return 0;  // 0 offset is invalid
+
+            size_t length;
+            size_t zeros;
+            if (code < 0xE0) {
+                length = code - 1;
+                zeros = 1;
+            } else if (code == 0xE0) {
+                length = 223;
+                zeros = 0;
+            } else {
+                length = code - 0xE1;
+                zeros = 2;
+            }
+            if (length > (size_t)(endOfSource - source) or length > (size_t)(endOfDestination - cursor))
+                return 0;
+            detail::copy_xor<Delimiter>(cursor, source, length);
+            cursor += length;
+            source += length;
+
+            // The last 0x00 of the last group is the implicit 0x00 at the end of the frame
+            if (source == endOfSource and zeros > 0)
+                zeros--;
+            if (zeros > (size_t)(endOfDestination - cursor))
+                return 0;
+            for (; zeros > 0; zeros--) {
+                *cursor++ = 0x00;
+            }
+        }
+
+        return cursor - destination;
+    }
+}   // Namespace cobs
+#endif  // COBS_ZPE_CPP_H